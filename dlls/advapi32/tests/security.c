@@ -8572,6 +8572,46 @@ static void test_group_as_file_owner(void)
     ok(ret, "got error %u\n", GetLastError());
 }
 
+static void test_repeated_open_access(void)
+{
+    static const char *sddl[] = { "D:(A;;GA;;;WD)", "D:(D;;GA;;;WD)" };
+    PSECURITY_DESCRIPTOR sd;
+    HANDLE event, handle;
+    unsigned int i, j;
+    BOOL ret;
+
+    event = CreateEventA(NULL, FALSE, FALSE, "test_repeated_open_access");
+    ok(event != NULL, "CreateEvent failed, error %u\n", GetLastError());
+
+    for (i = 0; i < 4; i++)
+    {
+        ret = ConvertStringSecurityDescriptorToSecurityDescriptorA(sddl[i % 2], SDDL_REVISION_1, &sd, NULL);
+        ok(ret, "ConvertStringSecurityDescriptorToSecurityDescriptor failed, error %u\n", GetLastError());
+        ret = SetKernelObjectSecurity(event, DACL_SECURITY_INFORMATION, sd);
+        ok(ret, "SetKernelObjectSecurity failed, error %u\n", GetLastError());
+        LocalFree(sd);
+
+        /* the result must follow the current descriptor on every open */
+        for (j = 0; j < 3; j++)
+        {
+            SetLastError(0xdeadbeef);
+            handle = OpenEventA(EVENT_MODIFY_STATE, FALSE, "test_repeated_open_access");
+            if (i % 2)
+            {
+                ok(!handle, "%u: OpenEvent succeeded\n", i);
+                ok(GetLastError() == ERROR_ACCESS_DENIED, "%u: got error %u\n", i, GetLastError());
+            }
+            else
+            {
+                ok(handle != NULL, "%u: OpenEvent failed, error %u\n", i, GetLastError());
+                CloseHandle(handle);
+            }
+        }
+    }
+
+    CloseHandle(event);
+}
+
 START_TEST(security)
 {
     init();
@@ -8641,6 +8681,7 @@ START_TEST(security)
     test_GetKernelObjectSecurity();
     test_elevation();
     test_group_as_file_owner();
+    test_repeated_open_access();
 
     /* Must be the last test, modifies process token */
     test_token_security_descriptor();
@@ -559,6 +559,59 @@ static void test_CreatePolyPolygonRgn(void)
     DeleteObject(region);
 }
 
+static void test_CombineRgn(void)
+{
+    HRGN rect_rgn, complex_rgn, tmp, dst;
+    RECT rect;
+    int ret;
+
+    rect_rgn = CreateRectRgn(0, 0, 100, 100);
+    complex_rgn = CreateRectRgn(10, 10, 20, 20);
+    tmp = CreateRectRgn(30, 30, 40, 40);
+    ret = CombineRgn(complex_rgn, complex_rgn, tmp, RGN_OR);
+    ok(ret == COMPLEXREGION, "expected COMPLEXREGION, got %d\n", ret);
+    dst = CreateRectRgn(0, 0, 0, 0);
+
+    /* rectangle containing the other region */
+    ret = CombineRgn(dst, rect_rgn, complex_rgn, RGN_AND);
+    ok(ret == COMPLEXREGION, "expected COMPLEXREGION, got %d\n", ret);
+    ok(EqualRgn(dst, complex_rgn), "regions are not equal\n");
+    ret = CombineRgn(dst, complex_rgn, rect_rgn, RGN_AND);
+    ok(ret == COMPLEXREGION, "expected COMPLEXREGION, got %d\n", ret);
+    ok(EqualRgn(dst, complex_rgn), "regions are not equal\n");
+    ret = CombineRgn(dst, complex_rgn, rect_rgn, RGN_DIFF);
+    ok(ret == NULLREGION, "expected NULLREGION, got %d\n", ret);
+    ret = CombineRgn(dst, rect_rgn, complex_rgn, RGN_OR);
+    ok(ret == SIMPLEREGION, "expected SIMPLEREGION, got %d\n", ret);
+    ok(EqualRgn(dst, rect_rgn), "regions are not equal\n");
+
+    /* two rectangles */
+    SetRectRgn(tmp, 50, 50, 150, 150);
+    ret = CombineRgn(dst, rect_rgn, tmp, RGN_AND);
+    ok(ret == SIMPLEREGION, "expected SIMPLEREGION, got %d\n", ret);
+    GetRgnBox(dst, &rect);
+    ok(rect.left == 50 && rect.top == 50 && rect.right == 100 && rect.bottom == 100,
+       "wrong region box %s\n", wine_dbgstr_rect(&rect));
+
+    /* partial overlap, destination is one of the sources */
+    ret = CombineRgn(tmp, complex_rgn, tmp, RGN_DIFF);
+    ok(ret == COMPLEXREGION, "expected COMPLEXREGION, got %d\n", ret);
+    ok(EqualRgn(tmp, complex_rgn), "regions are not equal\n");
+    SetRectRgn(tmp, 15, 0, 35, 100);
+    ret = CombineRgn(dst, complex_rgn, tmp, RGN_DIFF);
+    ok(ret == COMPLEXREGION, "expected COMPLEXREGION, got %d\n", ret);
+    SetRectRgn(rect_rgn, 10, 10, 15, 20);
+    CombineRgn(tmp, rect_rgn, 0, RGN_COPY);
+    SetRectRgn(rect_rgn, 35, 30, 40, 40);
+    CombineRgn(tmp, tmp, rect_rgn, RGN_OR);
+    ok(EqualRgn(dst, tmp), "regions are not equal\n");
+
+    DeleteObject(rect_rgn);
+    DeleteObject(complex_rgn);
+    DeleteObject(tmp);
+    DeleteObject(dst);
+}
+
 START_TEST(clipping)
 {
     test_GetRandomRgn();
@@ -567,4 +620,5 @@ START_TEST(clipping)
     test_memory_dc_clipping();
     test_window_dc_clipping();
     test_CreatePolyPolygonRgn();
+    test_CombineRgn();
 }
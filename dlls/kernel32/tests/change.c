@@ -797,6 +797,91 @@ static void test_readdirectorychanges_filedir(void)
     ok( r == TRUE, "failed to remove directory\n");
 }
 
+static void test_readdirectorychanges_subdirs(void)
+{
+    static const WCHAR expect[] = {'s','u','b','9','9','\\','f','i','l','e',0};
+    char path[MAX_PATH], subdir[MAX_PATH], file[MAX_PATH];
+    char buffer[0x1000];
+    PFILE_NOTIFY_INFORMATION pfni;
+    DWORD filter, count, len, i, r;
+    HANDLE hdir, hfile;
+    OVERLAPPED ov;
+
+    r = GetTempPathA( MAX_PATH, path );
+    ok( r != 0, "temp path failed\n");
+    strcat( path, "subdirs" );
+    RemoveDirectoryA( path );
+
+    r = CreateDirectoryA( path, NULL );
+    ok( r == TRUE, "failed to create directory\n");
+
+    hdir = CreateFileA( path, GENERIC_READ|SYNCHRONIZE|FILE_LIST_DIRECTORY,
+                        FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL );
+    ok( hdir != INVALID_HANDLE_VALUE, "failed to open directory\n");
+
+    ov.hEvent = CreateEventW( NULL, 0, 0, NULL );
+    filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
+
+    r = ReadDirectoryChangesW( hdir, buffer, sizeof(buffer), TRUE, filter, NULL, &ov, NULL );
+    ok( r == TRUE, "should return true\n");
+
+    /* enough subdirectories to make the server grow its tables */
+    for (i = 0; i < 100; i++)
+    {
+        sprintf( subdir, "%s\\sub%u", path, i );
+        r = CreateDirectoryA( subdir, NULL );
+        ok( r == TRUE, "failed to create directory %u\n", i );
+    }
+
+    count = 0;
+    while (count < 100)
+    {
+        r = WaitForSingleObject( ov.hEvent, 1000 );
+        ok( r == WAIT_OBJECT_0, "event should be ready, got %u records\n", count );
+        if (r != WAIT_OBJECT_0) break;
+
+        pfni = (PFILE_NOTIFY_INFORMATION)buffer;
+        for (;;)
+        {
+            if (pfni->Action == FILE_ACTION_ADDED) count++;
+            if (!pfni->NextEntryOffset) break;
+            pfni = (PFILE_NOTIFY_INFORMATION)((char *)pfni + pfni->NextEntryOffset);
+        }
+
+        r = ReadDirectoryChangesW( hdir, buffer, sizeof(buffer), TRUE, filter, NULL, &ov, NULL );
+        ok( r == TRUE, "should return true\n");
+    }
+
+    sprintf( file, "%s\\sub99\\file", path );
+    hfile = CreateFileA( file, GENERIC_READ|GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( hfile != INVALID_HANDLE_VALUE, "failed to create file\n");
+    CloseHandle( hfile );
+
+    r = WaitForSingleObject( ov.hEvent, 1000 );
+    ok( r == WAIT_OBJECT_0, "event should be ready\n" );
+
+    len = lstrlenW( expect );
+    pfni = (PFILE_NOTIFY_INFORMATION)buffer;
+    ok( pfni->Action == FILE_ACTION_ADDED, "action wrong %u\n", pfni->Action );
+    ok( pfni->FileNameLength == len * sizeof(WCHAR), "len wrong %u\n", pfni->FileNameLength );
+    ok( !memcmp( pfni->FileName, expect, len * sizeof(WCHAR) ), "name wrong\n" );
+
+    CancelIo( hdir );
+    CloseHandle( hdir );
+    CloseHandle( ov.hEvent );
+
+    DeleteFileA( file );
+    for (i = 0; i < 100; i++)
+    {
+        sprintf( subdir, "%s\\sub%u", path, i );
+        r = RemoveDirectoryA( subdir );
+        ok( r == TRUE, "failed to remove directory %u\n", i );
+    }
+    r = RemoveDirectoryA( path );
+    ok( r == TRUE, "failed to remove directory\n");
+}
+
 static void CALLBACK readdirectorychanges_cr(DWORD error, DWORD len, LPOVERLAPPED ov)
 {
     ok(error == 0, "ReadDirectoryChangesW error %d\n", error);
@@ -1096,6 +1181,7 @@ START_TEST(change)
     test_readdirectorychanges();
     test_readdirectorychanges_null();
     test_readdirectorychanges_filedir();
+    test_readdirectorychanges_subdirs();
     test_readdirectorychanges_cr();
     test_ffcn_directory_overlap();
 }
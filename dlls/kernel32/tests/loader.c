@@ -87,6 +87,7 @@ static BOOL (WINAPI *pIsWow64Process)(HANDLE,PBOOL);
 static BOOL (WINAPI *pWow64DisableWow64FsRedirection)(void **);
 static BOOL (WINAPI *pWow64RevertWow64FsRedirection)(void *);
 static HMODULE (WINAPI *pLoadPackagedLibrary)(LPCWSTR lpwLibFileName, DWORD Reserved);
+static char * (CDECL *pwine_get_unix_file_name)(LPCWSTR);
 
 static PVOID RVAToAddr(DWORD_PTR rva, HMODULE module)
 {
@@ -4012,6 +4013,46 @@ static void test_dll_file( const char *name )
 #undef OK_FIELD
 }
 
+static void test_exported_names( const char *name )
+{
+    HMODULE module = GetModuleHandleA( name );
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    const DWORD *names, *functions;
+    const WORD *ordinals;
+    ULONG exp_size;
+    FARPROC proc, proc2;
+    DWORD i;
+
+    exports = pRtlImageDirectoryEntryToData( module, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &exp_size );
+    ok( exports != NULL, "%s: no export directory\n", name );
+    if (!exports) return;
+
+    names = (const DWORD *)((char *)module + exports->AddressOfNames);
+    ordinals = (const WORD *)((char *)module + exports->AddressOfNameOrdinals);
+    functions = (const DWORD *)((char *)module + exports->AddressOfFunctions);
+
+    /* look up every name twice, so that cached lookups get exercised too */
+    for (i = 0; i < 2 * exports->NumberOfNames; i++)
+    {
+        const char *export = (const char *)module + names[i % exports->NumberOfNames];
+        const char *addr = (const char *)module + functions[ordinals[i % exports->NumberOfNames]];
+
+        proc = GetProcAddress( module, export );
+        if (addr >= (const char *)exports && addr < (const char *)exports + exp_size)
+        {
+            /* forwarded export, the target must not change between lookups */
+            proc2 = GetProcAddress( module, export );
+            ok( proc == proc2, "%s: wrong forward for %s %p / %p\n", name, export, proc, proc2 );
+        }
+        else ok( proc == (FARPROC)addr, "%s: wrong address for %s %p / %p\n", name, export, proc, addr );
+    }
+
+    SetLastError( 0xdeadbeef );
+    proc = GetProcAddress( module, "winetest_no_such_export" );
+    ok( !proc, "%s: got %p for missing export\n", name, proc );
+    ok( GetLastError() == ERROR_PROC_NOT_FOUND, "%s: wrong error %u\n", name, GetLastError() );
+}
+
 static void test_LoadPackagedLibrary(void)
 {
     HMODULE h;
@@ -4056,6 +4097,168 @@ static void test_Wow64Transition(void)
             debugstr_wn(name->SectionFileName.Buffer, name->SectionFileName.Length / sizeof(WCHAR)));
 }
 
+struct reloc_data
+{
+    ULONG_PTR             ptr;         /* relocated pointer to value */
+    DWORD                 value;
+    DWORD                 pad;
+    IMAGE_BASE_RELOCATION rel;
+    WORD                  entries[2];
+};
+
+#define RELOC_TEST_BASE  0x12340000
+#define RELOC_TEST_VALUE 0x12345678
+
+static void create_reloc_test_dll( char dll_name[MAX_PATH] )
+{
+    char temp_path[MAX_PATH];
+    IMAGE_SECTION_HEADER section;
+    IMAGE_NT_HEADERS nt;
+    struct reloc_data data;
+    HANDLE hfile;
+    DWORD dummy;
+
+#define DATA_RVA(ptr) (page_size + ((char *)(ptr) - (char *)&data))
+    nt = nt_header_template;
+    nt.FileHeader.NumberOfSections = 1;
+    nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_DLL;
+    nt.OptionalHeader.AddressOfEntryPoint = 0;
+    nt.OptionalHeader.SectionAlignment = page_size;
+    nt.OptionalHeader.FileAlignment = 0x200;
+    nt.OptionalHeader.ImageBase = RELOC_TEST_BASE;
+    nt.OptionalHeader.SizeOfImage = 2 * page_size;
+    nt.OptionalHeader.SizeOfHeaders = nt.OptionalHeader.FileAlignment;
+    nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    memset( nt.OptionalHeader.DataDirectory, 0, sizeof(nt.OptionalHeader.DataDirectory) );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress = DATA_RVA( &data.rel );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size = sizeof(data.rel) + sizeof(data.entries);
+
+    memset( &data, 0, sizeof(data) );
+    data.ptr = nt.OptionalHeader.ImageBase + DATA_RVA( &data.value );
+    data.value = RELOC_TEST_VALUE;
+    data.rel.VirtualAddress = page_size;
+    data.rel.SizeOfBlock = sizeof(data.rel) + sizeof(data.entries);
+#ifdef _WIN64
+    data.entries[0] = (IMAGE_REL_BASED_DIR64 << 12) | FIELD_OFFSET( struct reloc_data, ptr );
+#else
+    data.entries[0] = (IMAGE_REL_BASED_HIGHLOW << 12) | FIELD_OFFSET( struct reloc_data, ptr );
+#endif
+    data.entries[1] = IMAGE_REL_BASED_ABSOLUTE << 12;
+
+    memset( &section, 0, sizeof(section) );
+    memcpy( section.Name, ".data", sizeof(".data") );
+    section.PointerToRawData = nt.OptionalHeader.FileAlignment;
+    section.VirtualAddress = nt.OptionalHeader.SectionAlignment;
+    section.Misc.VirtualSize = sizeof(data);
+    section.SizeOfRawData = sizeof(data);
+    section.Characteristics = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE;
+#undef DATA_RVA
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "ldr", 0, dll_name );
+
+    hfile = CreateFileA( dll_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, 0 );
+    ok( hfile != INVALID_HANDLE_VALUE, "creation failed\n" );
+
+    WriteFile( hfile, &dos_header, sizeof(dos_header), &dummy, NULL );
+    WriteFile( hfile, &nt, sizeof(nt), &dummy, NULL );
+    WriteFile( hfile, &section, sizeof(section), &dummy, NULL );
+
+    SetFilePointer( hfile, section.PointerToRawData, NULL, SEEK_SET );
+    WriteFile( hfile, &data, sizeof(data), &dummy, NULL );
+
+    CloseHandle( hfile );
+}
+
+static void reloc_cache_child( const char *dll_name )
+{
+    struct reloc_data *data, copy;
+    HMODULE mod, prev = NULL;
+    void *reserved;
+    int i;
+
+    /* make sure that the image gets relocated */
+    reserved = VirtualAlloc( (void *)RELOC_TEST_BASE, page_size, MEM_RESERVE, PAGE_NOACCESS );
+
+    /* load it twice, the second time should find it in the cache when it gets the same address */
+    for (i = 0; i < 2; i++)
+    {
+        mod = LoadLibraryA( dll_name );
+        ok( mod != NULL, "%d: failed to load %s err %u\n", i, dll_name, GetLastError() );
+        if (!mod) break;
+        ok( mod != (HMODULE)RELOC_TEST_BASE, "%d: image not relocated\n", i );
+
+        data = (struct reloc_data *)((char *)mod + page_size);
+        ok( data->ptr == (ULONG_PTR)&data->value, "%d: wrong relocated pointer %p, expected %p\n",
+            i, (void *)data->ptr, &data->value );
+        ok( data->value == RELOC_TEST_VALUE, "%d: wrong value %#x\n", i, data->value );
+        if (!i) copy = *data;
+        else if (mod == prev) ok( !memcmp( data, &copy, sizeof(copy) ), "%d: contents differ\n", i );
+        prev = mod;
+        FreeLibrary( mod );
+    }
+
+    if (reserved) VirtualFree( reserved, 0, MEM_RELEASE );
+}
+
+static void test_reloc_cache(void)
+{
+    char dll_name[MAX_PATH], cache_dir[MAX_PATH], path[MAX_PATH], cmdline[3 * MAX_PATH];
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    WIN32_FIND_DATAA data;
+    WCHAR cache_dirW[MAX_PATH];
+    char *unix_dir = NULL;
+    HANDLE find;
+    char **argv;
+    BOOL ret;
+    int i;
+
+    GetTempPathA( MAX_PATH, path );
+    GetTempFileNameA( path, "rlc", 0, cache_dir );
+    DeleteFileA( cache_dir );
+    ret = CreateDirectoryA( cache_dir, NULL );
+    ok( ret, "failed to create %s err %u\n", cache_dir, GetLastError() );
+
+    /* the cache is a Wine extension, elsewhere the image is simply relocated by the loader */
+    MultiByteToWideChar( CP_ACP, 0, cache_dir, -1, cache_dirW, MAX_PATH );
+    if (pwine_get_unix_file_name && (unix_dir = pwine_get_unix_file_name( cache_dirW )))
+        SetEnvironmentVariableA( "WINE_RELOC_CACHE", unix_dir );
+
+    create_reloc_test_dll( dll_name );
+    winetest_get_mainargs( &argv );
+
+    /* the second process should map the image from the cache */
+    for (i = 0; i < 2; i++)
+    {
+        sprintf( cmdline, "\"%s\" loader reloc_cache %s", argv[0], dll_name );
+        ret = CreateProcessA( argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+        ok( ret, "CreateProcess(%s) error %u\n", cmdline, GetLastError() );
+        if (!ret) break;
+        wait_child_process( pi.hProcess );
+        CloseHandle( pi.hThread );
+        CloseHandle( pi.hProcess );
+    }
+
+    SetEnvironmentVariableA( "WINE_RELOC_CACHE", NULL );
+    HeapFree( GetProcessHeap(), 0, unix_dir );
+    DeleteFileA( dll_name );
+
+    sprintf( path, "%s\\*", cache_dir );
+    if ((find = FindFirstFileA( path, &data )) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            sprintf( path, "%s\\%s", cache_dir, data.cFileName );
+            DeleteFileA( path );
+        } while (FindNextFileA( find, &data ));
+        FindClose( find );
+    }
+    RemoveDirectoryA( cache_dir );
+}
+
 START_TEST(loader)
 {
     int argc;
@@ -4094,6 +4297,7 @@ START_TEST(loader)
     pWow64RevertWow64FsRedirection = (void *)GetProcAddress(kernel32, "Wow64RevertWow64FsRedirection");
     pResolveDelayLoadedAPI = (void *)GetProcAddress(kernel32, "ResolveDelayLoadedAPI");
     pLoadPackagedLibrary = (void *)GetProcAddress(kernel32, "LoadPackagedLibrary");
+    pwine_get_unix_file_name = (void *)GetProcAddress(kernel32, "wine_get_unix_file_name");
 
     if (pIsWow64Process) pIsWow64Process( GetCurrentProcess(), &is_wow64 );
     GetSystemInfo( &si );
@@ -4112,6 +4316,11 @@ START_TEST(loader)
         *child_failures = -1;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc > 3 && !strcmp( argv[2], "reloc_cache" ))
+    {
+        reloc_cache_child( argv[3] );
+        return;
+    }
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -4132,7 +4341,10 @@ START_TEST(loader)
     test_dll_file( "kernel32.dll" );
     test_dll_file( "advapi32.dll" );
     test_dll_file( "user32.dll" );
+    test_exported_names( "ntdll.dll" );
+    test_exported_names( "kernel32.dll" );
     test_Wow64Transition();
+    test_reloc_cache();
     /* loader test must be last, it can corrupt the internal loader state on Windows */
     test_Loader();
 }
@@ -3217,9 +3217,10 @@ static void create_overlapped_pipe(DWORD mode, HANDLE *client, HANDLE *server)
 
 static void test_overlapped_transport(BOOL msg_mode, BOOL msg_read_mode)
 {
+    static const DWORD sizes[] = {1, 100, 1000, 4000};
     OVERLAPPED overlapped, overlapped2;
     HANDLE server, client, flush;
-    DWORD read_bytes;
+    DWORD read_bytes, i;
     HANDLE process;
     char buf[60000];
     BOOL res;
@@ -3237,6 +3238,18 @@ static void test_overlapped_transport(BOOL msg_mode, BOOL msg_read_mode)
           msg_mode ? "message mode" : "byte mode", msg_read_mode ? "message read" : "byte read");
     test_blocking_rw(client, server, 6000, msg_mode, msg_read_mode);
 
+    /* reads with a larger buffer than the queued data return all of it */
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        memset(buf, 'a' + i, sizes[i]);
+        overlapped_write_sync(server, buf, sizes[i]);
+        test_peek_pipe(client, sizes[i], sizes[i], msg_mode ? sizes[i] : 0);
+        memset(buf, 0, sizes[i]);
+        overlapped_read_sync(client, buf, sizeof(buf), sizes[i], FALSE);
+        ok(buf[0] == 'a' + i && buf[sizes[i] - 1] == 'a' + i, "got wrong data for size %u\n", sizes[i]);
+        test_peek_pipe(client, 0, 0, 0);
+    }
+
     CloseHandle(client);
     CloseHandle(server);
 
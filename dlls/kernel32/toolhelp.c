@@ -174,7 +174,7 @@ static BOOL fetch_process_thread( DWORD flags, SYSTEM_PROCESS_INFORMATION** pspi
                                   ULONG* num_pcs, ULONG* num_thd)
 {
     NTSTATUS                    status;
-    ULONG                       size, offset;
+    ULONG                       size, needed, offset;
     PSYSTEM_PROCESS_INFORMATION spi;
 
     *num_pcs = *num_thd = 0;
@@ -184,7 +184,7 @@ static BOOL fetch_process_thread( DWORD flags, SYSTEM_PROCESS_INFORMATION** pspi
     for (;;)
     {
         status = NtQuerySystemInformation( SystemProcessInformation, *pspi,
-                                           size, NULL );
+                                           size, &needed );
         switch (status)
         {
         case STATUS_SUCCESS:
@@ -198,7 +198,9 @@ static BOOL fetch_process_thread( DWORD flags, SYSTEM_PROCESS_INFORMATION** pspi
             } while ((offset = spi->NextEntryOffset));
             return TRUE;
         case STATUS_INFO_LENGTH_MISMATCH:
-            *pspi = HeapReAlloc( GetProcessHeap(), 0, *pspi, size *= 2 );
+            /* go straight to the required size instead of doubling up to it */
+            size = max( size * 2, needed );
+            *pspi = HeapReAlloc( GetProcessHeap(), 0, *pspi, size );
             break;
         default:
             SetLastError( RtlNtStatusToDosError( status ) );
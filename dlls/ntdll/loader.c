@@ -134,8 +134,20 @@ typedef struct _wine_modref
     struct file_id        id;
     ULONG                 CheckSum;
     BOOL                  system;
+    ULONG                 export_lookups;     /* number of exports looked up by name */
+    ULONG                 export_hash_mask;   /* size - 1 of the export name hash table */
+    DWORD                *export_hash;        /* export name hash table, built on demand */
+    ULONG                 forward_cache_gen;  /* unload generation of the forward cache */
+    FARPROC              *forward_cache;      /* resolved forwarded exports, indexed by ordinal */
 } WINE_MODREF;
 
+/* number of lookups by name before a module gets an export name hash table */
+#define EXPORT_HASH_THRESHOLD 32
+/* minimum number of exported names for building a hash table to be worthwhile */
+#define EXPORT_HASH_MIN_NAMES 64
+
+static ULONG forward_cache_gen;  /* incremented on every module unload */
+
 static UINT tls_module_count;      /* number of modules with TLS directory */
 static IMAGE_TLS_DIRECTORY *tls_dirs;  /* array of TLS directories */
 LIST_ENTRY tls_links = { &tls_links, &tls_links };
@@ -186,9 +198,9 @@ static LDR_DDAG_NODE *node_ntdll, *node_kernel32;
 
 static NTSTATUS load_dll( const WCHAR *load_path, const WCHAR *libname, DWORD flags, WINE_MODREF** pwm, BOOL system );
 static NTSTATUS process_attach( LDR_DDAG_NODE *node, LPVOID lpReserved );
-static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+static FARPROC find_ordinal_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
                                     DWORD exp_size, DWORD ordinal, LPCWSTR load_path );
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+static FARPROC find_named_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
                                   DWORD exp_size, const char *name, int hint, LPCWSTR load_path );
 
 /* convert PE image VirtualAddress to Real Address */
@@ -797,7 +809,7 @@ static NTSTATUS walk_node_dependencies( LDR_DDAG_NODE *node, void *context,
  * Find the final function pointer for a forwarded function.
  * The loader_section must be locked while calling this function.
  */
-static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWSTR load_path )
+static FARPROC find_forwarded_export( WINE_MODREF *imp, const char *forward, LPCWSTR load_path )
 {
     const IMAGE_EXPORT_DIRECTORY *exports;
     DWORD exp_size;
@@ -811,7 +823,6 @@ static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWS
 
     if (!(wm = find_basename_module( mod_name )))
     {
-        WINE_MODREF *imp = get_modref( module );
         TRACE( "delay loading %s for '%s'\n", debugstr_w(mod_name), forward );
         if (load_dll( load_path, mod_name, 0, &wm, imp->system ) == STATUS_SUCCESS &&
             !(wm->ldr.Flags & LDR_DONT_RESOLVE_REFS))
@@ -840,19 +851,62 @@ static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWS
         const char *name = end + 1;
 
         if (*name == '#') { /* ordinal */
-            proc = find_ordinal_export( wm->ldr.DllBase, exports, exp_size,
+            proc = find_ordinal_export( wm, exports, exp_size,
                                         atoi(name+1) - exports->Base, load_path );
         } else
-            proc = find_named_export( wm->ldr.DllBase, exports, exp_size, name, -1, load_path );
+            proc = find_named_export( wm, exports, exp_size, name, -1, load_path );
     }
 
     if (!proc)
     {
         ERR("function not found for forward '%s' used by %s."
             " If you are using builtin %s, try using the native one instead.\n",
-            forward, debugstr_w(get_modref(module)->ldr.FullDllName.Buffer),
-            debugstr_w(get_modref(module)->ldr.BaseDllName.Buffer) );
+            forward, debugstr_w(imp->ldr.FullDllName.Buffer),
+            debugstr_w(imp->ldr.BaseDllName.Buffer) );
+    }
+    return proc;
+}
+
+
+/*************************************************************************
+ *		find_cached_forwarded_export
+ *
+ * Find a forwarded function, using the per-module cache of resolved forwards.
+ * The cache is flushed whenever a module gets unloaded, since the target
+ * of a forward may have gone away.
+ * The loader_section must be locked while calling this function.
+ */
+static FARPROC find_cached_forwarded_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
+                                             DWORD ordinal, const char *forward, LPCWSTR load_path )
+{
+    FARPROC proc;
+
+    /* relay and snoop thunks depend on the importing module, don't cache them */
+    if (TRACE_ON(relay) || TRACE_ON(snoop))
+        return find_forwarded_export( wm, forward, load_path );
+
+    if (wm->forward_cache && wm->forward_cache_gen != forward_cache_gen)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, wm->forward_cache );
+        wm->forward_cache = NULL;
+    }
+    if (wm->forward_cache && wm->forward_cache[ordinal]) return wm->forward_cache[ordinal];
+
+    if (!(proc = find_forwarded_export( wm, forward, load_path ))) return NULL;
+
+    /* resolving the forward may have loaded or unloaded modules */
+    if (wm->forward_cache_gen != forward_cache_gen && wm->forward_cache)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, wm->forward_cache );
+        wm->forward_cache = NULL;
+    }
+    if (!wm->forward_cache)
+    {
+        wm->forward_cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                             exports->NumberOfFunctions * sizeof(*wm->forward_cache) );
+        wm->forward_cache_gen = forward_cache_gen;
     }
+    if (wm->forward_cache) wm->forward_cache[ordinal] = proc;
     return proc;
 }
 
@@ -864,9 +918,10 @@ static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWS
  * The exports base must have been subtracted from the ordinal already.
  * The loader_section must be locked while calling this function.
  */
-static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+static FARPROC find_ordinal_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
                                     DWORD exp_size, DWORD ordinal, LPCWSTR load_path )
 {
+    HMODULE module = wm->ldr.DllBase;
     FARPROC proc;
     const DWORD *functions = get_rva( module, exports->AddressOfFunctions );
 
@@ -882,7 +937,7 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
     /* if the address falls into the export dir, it's a forward */
     if (((const char *)proc >= (const char *)exports) && 
         ((const char *)proc < (const char *)exports + exp_size))
-        return find_forwarded_export( module, (const char *)proc, load_path );
+        return find_cached_forwarded_export( wm, exports, ordinal, (const char *)proc, load_path );
 
     if (TRACE_ON(snoop))
     {
@@ -921,15 +976,79 @@ static int find_name_in_exports( HMODULE module, const IMAGE_EXPORT_DIRECTORY *e
 }
 
 
+/*************************************************************************
+ *		hash_export_name
+ */
+static inline ULONG hash_export_name( const char *name )
+{
+    ULONG hash = 2166136261u;  /* FNV-1a */
+
+    while (*name) hash = (hash ^ (unsigned char)*name++) * 16777619;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		build_export_hash
+ *
+ * Build the export name hash table of a module. Each entry stores the
+ * index in the names table plus one, 0 being used for empty slots.
+ * The loader_section must be locked while calling this function.
+ */
+static void build_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    ULONG i, pos, size = 16;
+    DWORD *hash;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*hash) ))) return;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        const char *name = get_rva( wm->ldr.DllBase, names[i] );
+
+        for (pos = hash_export_name( name ) & (size - 1); hash[pos]; pos = (pos + 1) & (size - 1))
+            if (!strcmp( get_rva( wm->ldr.DllBase, names[hash[pos] - 1] ), name )) break;
+        if (!hash[pos]) hash[pos] = i + 1;
+    }
+    wm->export_hash_mask = size - 1;
+    wm->export_hash = hash;
+}
+
+
+/*************************************************************************
+ *		find_name_in_export_hash
+ *
+ * Helper for find_named_export. Returns -1 if the name is not exported.
+ * The loader_section must be locked while calling this function.
+ */
+static int find_name_in_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, const char *name )
+{
+    const WORD *ordinals = get_rva( wm->ldr.DllBase, exports->AddressOfNameOrdinals );
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    ULONG pos;
+
+    for (pos = hash_export_name( name ) & wm->export_hash_mask; wm->export_hash[pos];
+         pos = (pos + 1) & wm->export_hash_mask)
+    {
+        DWORD index = wm->export_hash[pos] - 1;
+        if (!strcmp( get_rva( wm->ldr.DllBase, names[index] ), name )) return ordinals[index];
+    }
+    return -1;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
  * Find an exported function by name.
  * The loader_section must be locked while calling this function.
  */
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+static FARPROC find_named_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
                                   DWORD exp_size, const char *name, int hint, LPCWSTR load_path )
 {
+    HMODULE module = wm->ldr.DllBase;
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int ordinal;
@@ -939,12 +1058,24 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     {
         char *ename = get_rva( module, names[hint] );
         if (!strcmp( ename, name ))
-            return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
+            return find_ordinal_export( wm, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
+    /* then use the hash table once the module has been looked up often enough */
+    if (exports->NumberOfNames >= EXPORT_HASH_MIN_NAMES)
+    {
+        if (!wm->export_hash && ++wm->export_lookups >= EXPORT_HASH_THRESHOLD)
+            build_export_hash( wm, exports );
+        if (wm->export_hash)
+        {
+            if ((ordinal = find_name_in_export_hash( wm, exports, name )) == -1) return NULL;
+            return find_ordinal_export( wm, exports, exp_size, ordinal, load_path );
+        }
+    }
+
+    /* otherwise do a binary search */
     if ((ordinal = find_name_in_exports( module, exports, name )) == -1) return NULL;
-    return find_ordinal_export( module, exports, exp_size, ordinal, load_path );
+    return find_ordinal_export( wm, exports, exp_size, ordinal, load_path );
 
 }
 
@@ -1071,7 +1202,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         {
             int ordinal = IMAGE_ORDINAL(import_list->u1.Ordinal);
 
-            thunk_list->u1.Function = (ULONG_PTR)find_ordinal_export( imp_mod, exports, exp_size,
+            thunk_list->u1.Function = (ULONG_PTR)find_ordinal_export( wmImp, exports, exp_size,
                                                                       ordinal - exports->Base, load_path );
             if (!thunk_list->u1.Function)
             {
@@ -1086,7 +1217,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         {
             IMAGE_IMPORT_BY_NAME *pe_name;
             pe_name = get_rva( module, (DWORD)import_list->u1.AddressOfData );
-            thunk_list->u1.Function = (ULONG_PTR)find_named_export( imp_mod, exports, exp_size,
+            thunk_list->u1.Function = (ULONG_PTR)find_named_export( wmImp, exports, exp_size,
                                                                     (const char*)pe_name->Name,
                                                                     pe_name->Hint, load_path );
             if (!thunk_list->u1.Function)
@@ -1904,16 +2035,17 @@ NTSTATUS WINAPI LdrGetProcedureAddress(HMODULE module, const ANSI_STRING *name,
     IMAGE_EXPORT_DIRECTORY *exports;
     DWORD exp_size;
     NTSTATUS ret = STATUS_PROCEDURE_NOT_FOUND;
+    WINE_MODREF *wm;
 
     RtlEnterCriticalSection( &loader_section );
 
     /* check if the module itself is invalid to return the proper error */
-    if (!get_modref( module )) ret = STATUS_DLL_NOT_FOUND;
+    if (!(wm = get_modref( module ))) ret = STATUS_DLL_NOT_FOUND;
     else if ((exports = RtlImageDirectoryEntryToData( module, TRUE,
                                                       IMAGE_DIRECTORY_ENTRY_EXPORT, &exp_size )))
     {
-        void *proc = name ? find_named_export( module, exports, exp_size, name->Buffer, -1, NULL )
-                          : find_ordinal_export( module, exports, exp_size, ord - exports->Base, NULL );
+        void *proc = name ? find_named_export( wm, exports, exp_size, name->Buffer, -1, NULL )
+                          : find_ordinal_export( wm, exports, exp_size, ord - exports->Base, NULL );
         if (proc)
         {
             *address = proc;
@@ -2567,7 +2699,7 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, const UNICODE_STRING *nt_nam
     void *module = NULL;
     SIZE_T len = 0;
     NTSTATUS status = NtMapViewOfSection( mapping, NtCurrentProcess(), &module, 0, 0, NULL, &len,
-                                          ViewShare, 0, PAGE_EXECUTE_READ );
+                                          ViewShare, MEM_DIFFERENT_IMAGE_BASE_OK, PAGE_EXECUTE_READ );
 
     if (status == STATUS_IMAGE_NOT_AT_BASE) status = STATUS_SUCCESS;
     if (status) return status;
@@ -3782,7 +3914,10 @@ static void free_modref( WINE_MODREF *wm )
     RtlReleaseActivationContext( wm->ldr.ActivationContext );
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
+    forward_cache_gen++;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->forward_cache );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
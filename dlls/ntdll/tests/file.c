@@ -1099,6 +1099,59 @@ static void test_set_io_completion(void)
     pNtClose( h );
 }
 
+static void test_io_completion_batch(void)
+{
+    FILE_IO_COMPLETION_INFORMATION info[200];
+    LARGE_INTEGER timeout = {{0}};
+    NTSTATUS res;
+    ULONG count, i;
+    HANDLE h;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        skip("NtRemoveIoCompletionEx() not present\n");
+        return;
+    }
+
+    res = pNtCreateIoCompletion( &h, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( res == STATUS_SUCCESS, "NtCreateIoCompletion failed: %#x\n", res );
+
+    for (i = 0; i < 150; i++)
+    {
+        res = pNtSetIoCompletion( h, i, i * 2, 0, i * 3 );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#x\n", res );
+    }
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 100, &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#x\n", res );
+    ok( count == 100, "wrong count %u\n", count );
+    for (i = 0; i < count; i++)
+    {
+        ok( info[i].CompletionKey == i, "%u: wrong key %#lx\n", i, info[i].CompletionKey );
+        ok( info[i].CompletionValue == i * 2, "%u: wrong value %#lx\n", i, info[i].CompletionValue );
+        ok( info[i].IoStatusBlock.Information == i * 3, "%u: wrong information %#lx\n",
+            i, info[i].IoStatusBlock.Information );
+    }
+
+    count = get_pending_msgs( h );
+    ok( count == 50, "wrong pending count %u\n", count );
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#x\n", res );
+    ok( count == 50, "wrong count %u\n", count );
+    for (i = 0; i < count; i++)
+        ok( info[i].CompletionKey == i + 100, "%u: wrong key %#lx\n", i, info[i].CompletionKey );
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx failed: %#x\n", res );
+    ok( count == 1, "wrong count %u\n", count );
+
+    pNtClose( h );
+}
+
 static void test_file_io_completion(void)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -5389,6 +5442,7 @@ START_TEST(file)
     append_file_test();
     nt_mailslot_test();
     test_set_io_completion();
+    test_io_completion_batch();
     test_file_io_completion();
     test_file_basic_information();
     test_file_all_information();
@@ -2500,6 +2500,60 @@ static void test_object_identity(void)
     pNtClose( h1 );
 }
 
+static void test_many_names(void)
+{
+    HANDLE events[300], pipes[100], h;
+    char name[64];
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        sprintf( name, "om.c-many-event-%u", i );
+        events[i] = CreateEventA( NULL, FALSE, FALSE, name );
+        ok( events[i] != 0, "%u: CreateEventA failed %u\n", i, GetLastError() );
+    }
+    for (i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        sprintf( name, "om.c-many-event-%u", i );
+        h = OpenEventA( EVENT_ALL_ACCESS, FALSE, name );
+        ok( h != 0, "%u: OpenEventA failed %u\n", i, GetLastError() );
+        CloseHandle( h );
+    }
+    for (i = 0; i < ARRAY_SIZE(events); i += 2) CloseHandle( events[i] );
+    for (i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        sprintf( name, "om.c-many-event-%u", i );
+        SetLastError( 0xdeadbeef );
+        h = OpenEventA( EVENT_ALL_ACCESS, FALSE, name );
+        if (i % 2)
+        {
+            ok( h != 0, "%u: OpenEventA failed %u\n", i, GetLastError() );
+            CloseHandle( h );
+        }
+        else
+        {
+            ok( !h, "%u: OpenEventA succeeded\n", i );
+            ok( GetLastError() == ERROR_FILE_NOT_FOUND, "%u: got error %u\n", i, GetLastError() );
+        }
+    }
+    for (i = 1; i < ARRAY_SIZE(events); i += 2) CloseHandle( events[i] );
+
+    for (i = 0; i < ARRAY_SIZE(pipes); i++)
+    {
+        sprintf( name, "\\\\.\\pipe\\om.c-many-pipe-%u", i );
+        pipes[i] = CreateNamedPipeA( name, PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE, 1, 256, 256, 0, NULL );
+        ok( pipes[i] != INVALID_HANDLE_VALUE, "%u: CreateNamedPipeA failed %u\n", i, GetLastError() );
+    }
+    for (i = 0; i < ARRAY_SIZE(pipes); i++)
+    {
+        sprintf( name, "\\\\.\\pipe\\om.c-many-pipe-%u", i );
+        h = CreateFileA( name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0 );
+        ok( h != INVALID_HANDLE_VALUE, "%u: CreateFileA failed %u\n", i, GetLastError() );
+        CloseHandle( h );
+        CloseHandle( pipes[i] );
+    }
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -2561,4 +2615,5 @@ START_TEST(om)
     test_get_next_thread();
     test_globalroot();
     test_object_identity();
+    test_many_names();
 }
@@ -1815,6 +1815,75 @@ static void test_NtFreeVirtualMemory(void)
     ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
 }
 
+static void test_large_reservation(void)
+{
+    MEMORY_BASIC_INFORMATION mbi;
+    SIZE_T size, total = (SIZE_T)64 << 30;
+    void *base = NULL, *addr;
+    char *mid;
+    NTSTATUS status;
+
+    if (!is_win64)
+    {
+        skip("Large reservations require a 64-bit address space.\n");
+        return;
+    }
+
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &base, 0, &total, MEM_RESERVE, PAGE_READWRITE);
+    if (status == STATUS_NO_MEMORY || status == STATUS_CONFLICTING_ADDRESSES)
+    {
+        skip("Cannot reserve %p bytes.\n", (void *)total);
+        return;
+    }
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+
+    status = NtQueryVirtualMemory(NtCurrentProcess(), base, MemoryBasicInformation, &mbi, sizeof(mbi), NULL);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+    ok(mbi.RegionSize == total, "Unexpected region size %p.\n", (void *)mbi.RegionSize);
+    ok(mbi.State == MEM_RESERVE, "Unexpected state %#lx.\n", mbi.State);
+
+    /* commit a few pages straddling a 4GB boundary */
+    mid = (char *)base + ((SIZE_T)8 << 30) - page_size;
+    addr = mid;
+    size = 2 * page_size;
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &addr, 0, &size, MEM_COMMIT, PAGE_READWRITE);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+    *(volatile char *)mid = 1;
+    *(volatile char *)(mid + page_size) = 1;
+
+    status = NtQueryVirtualMemory(NtCurrentProcess(), base, MemoryBasicInformation, &mbi, sizeof(mbi), NULL);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+    ok(mbi.RegionSize == mid - (char *)base, "Unexpected region size %p.\n", (void *)mbi.RegionSize);
+    ok(mbi.State == MEM_RESERVE, "Unexpected state %#lx.\n", mbi.State);
+
+    status = NtQueryVirtualMemory(NtCurrentProcess(), mid, MemoryBasicInformation, &mbi, sizeof(mbi), NULL);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+    ok(mbi.RegionSize == 2 * page_size, "Unexpected region size %p.\n", (void *)mbi.RegionSize);
+    ok(mbi.State == MEM_COMMIT, "Unexpected state %#lx.\n", mbi.State);
+    ok(mbi.Protect == PAGE_READWRITE, "Unexpected protection %#lx.\n", mbi.Protect);
+
+    status = NtQueryVirtualMemory(NtCurrentProcess(), mid + 2 * page_size, MemoryBasicInformation,
+                                  &mbi, sizeof(mbi), NULL);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+    ok(mbi.RegionSize == (char *)base + total - mid - 2 * page_size,
+       "Unexpected region size %p.\n", (void *)mbi.RegionSize);
+    ok(mbi.State == MEM_RESERVE, "Unexpected state %#lx.\n", mbi.State);
+
+    addr = mid;
+    size = 2 * page_size;
+    status = NtFreeVirtualMemory(NtCurrentProcess(), &addr, &size, MEM_DECOMMIT);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+
+    status = NtQueryVirtualMemory(NtCurrentProcess(), base, MemoryBasicInformation, &mbi, sizeof(mbi), NULL);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+    ok(mbi.RegionSize == total, "Unexpected region size %p.\n", (void *)mbi.RegionSize);
+    ok(mbi.State == MEM_RESERVE, "Unexpected state %#lx.\n", mbi.State);
+
+    size = 0;
+    status = NtFreeVirtualMemory(NtCurrentProcess(), &base, &size, MEM_RELEASE);
+    ok(status == STATUS_SUCCESS, "Unexpected status %08lx.\n", status);
+}
+
 START_TEST(virtual)
 {
     HMODULE mod;
@@ -1854,6 +1923,7 @@ START_TEST(virtual)
     test_NtAllocateVirtualMemoryEx();
     test_NtAllocateVirtualMemoryEx_address_requirements();
     test_NtFreeVirtualMemory();
+    test_large_reservation();
     test_RtlCreateUserStack();
     test_NtMapViewOfSection();
     test_NtMapViewOfSectionEx();
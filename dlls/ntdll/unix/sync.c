@@ -1972,9 +1972,10 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+    struct completion_msg msgs[64];
     NTSTATUS status;
     int waited = 0;
-    ULONG i = 0;
+    ULONG i = 0, j, max, got;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, count, written, timeout, alertable );
 
@@ -1982,21 +1983,34 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
     {
         while (i < count)
         {
+            max = min( count - i - 1, ARRAY_SIZE(msgs) );
+            got = 0;
             SERVER_START_REQ( remove_completion )
             {
                 req->handle = wine_server_obj_handle( handle );
                 req->waited = waited;
+                wine_server_set_reply( req, msgs, max * sizeof(msgs[0]) );
                 if (!(status = wine_server_call( req )))
                 {
                     info[i].CompletionKey             = reply->ckey;
                     info[i].CompletionValue           = reply->cvalue;
                     info[i].IoStatusBlock.Information = reply->information;
                     info[i].IoStatusBlock.u.Status    = reply->status;
+                    got = wine_server_reply_size( reply ) / sizeof(msgs[0]);
                 }
             }
             SERVER_END_REQ;
             if (status != STATUS_SUCCESS) break;
             ++i;
+            for (j = 0; j < got; j++, i++)
+            {
+                info[i].CompletionKey             = msgs[j].ckey;
+                info[i].CompletionValue           = msgs[j].cvalue;
+                info[i].IoStatusBlock.Information = msgs[j].information;
+                info[i].IoStatusBlock.u.Status    = msgs[j].status;
+            }
+            /* the server returns everything that fits, so a short batch means the queue is empty */
+            if (got < max) break;
         }
         if (i || status != STATUS_PENDING)
         {
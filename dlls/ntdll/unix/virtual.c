@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
@@ -54,6 +55,12 @@
 #ifdef HAVE_LIBPROCSTAT_H
 # include <libprocstat.h>
 #endif
+#ifdef HAVE_LINUX_USERFAULTFD_H
+# include <linux/fs.h>
+# include <linux/userfaultfd.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+#endif
 #include <unistd.h>
 #include <dlfcn.h>
 #ifdef HAVE_VALGRIND_VALGRIND_H
@@ -204,6 +211,9 @@ static const size_t pages_vprot_shift = 20;
 static const size_t pages_vprot_mask = (1 << 20) - 1;
 static size_t pages_vprot_size;
 static BYTE **pages_vprot;
+/* fill value of each chunk, its bytes are only valid if the mixed flag is set */
+static WORD *pages_vprot_fill;
+#define VPROT_CHUNK_MIXED 0x100
 #else  /* on 32-bit we use a simple array with one byte per page */
 static BYTE *pages_vprot;
 #endif
@@ -213,7 +223,20 @@ static int pagemap_fd, pagemap_reset_fd, clear_refs_fd;
 #define PAGE_FLAGS_BUFFER_LENGTH 1024
 #define PM_SOFT_DIRTY_PAGE (1ull << 57)
 
+#if defined(HAVE_LINUX_USERFAULTFD_H) && defined(UFFD_FEATURE_WP_ASYNC) && defined(PAGEMAP_SCAN)
+/* userfaultfd write-protect tracking, dirty pages are read with PAGEMAP_SCAN */
+static BOOL use_uffd_writewatch;
+static int uffd_fd = -1;
+#else
+static const BOOL use_uffd_writewatch = FALSE;
+#endif
+
 static void reset_write_watches( void *base, SIZE_T size );
+static void register_uffd_write_watches( void *base, SIZE_T size );
+
+static const char *reloc_cache_dir;  /* directory of the relocated image cache, NULL if disabled */
+#define RELOC_CACHE_VERSION  2  /* bump when the format of the cache entries changes */
+#define RELOC_CACHE_MAX_SIZE (512 * 1024 * 1024)
 
 static struct file_view *view_block_start, *view_block_end, *next_free_view;
 #ifdef _WIN64
@@ -891,6 +914,43 @@ static inline int is_view_valloc( const struct file_view *view )
     return !(view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT));
 }
 
+#ifdef _WIN64
+/***********************************************************************
+ *           get_vprot_chunk
+ *
+ * Return the page protection bytes of a chunk for modification,
+ * expanding its fill value if necessary.
+ */
+static BYTE *get_vprot_chunk( size_t idx )
+{
+    size_t i = idx >> pages_vprot_shift;
+
+    if (!(pages_vprot_fill[i] & VPROT_CHUNK_MIXED))
+    {
+        /* uniform chunks are kept zeroed, see set_vprot_chunk_fill */
+        if (pages_vprot_fill[i]) memset( pages_vprot[i], pages_vprot_fill[i], pages_vprot_mask + 1 );
+        pages_vprot_fill[i] = VPROT_CHUNK_MIXED;
+    }
+    return pages_vprot[i];
+}
+
+
+/***********************************************************************
+ *           set_vprot_chunk_fill
+ *
+ * Set the protection of a whole chunk, releasing its bytes.
+ */
+static void set_vprot_chunk_fill( size_t idx, BYTE vprot )
+{
+    size_t i = idx >> pages_vprot_shift;
+
+    if (pages_vprot_fill[i] & VPROT_CHUNK_MIXED)
+        madvise( pages_vprot[i], pages_vprot_mask + 1, MADV_DONTNEED );
+    pages_vprot_fill[i] = vprot;
+}
+#endif
+
+
 /***********************************************************************
  *           get_page_vprot
  *
@@ -902,7 +962,8 @@ static BYTE get_page_vprot( const void *addr )
 
 #ifdef _WIN64
     if ((idx >> pages_vprot_shift) >= pages_vprot_size) return 0;
-    if (!pages_vprot[idx >> pages_vprot_shift]) return 0;
+    if (!(pages_vprot_fill[idx >> pages_vprot_shift] & VPROT_CHUNK_MIXED))
+        return pages_vprot_fill[idx >> pages_vprot_shift];
     return pages_vprot[idx >> pages_vprot_shift][idx & pages_vprot_mask];
 #else
     return pages_vprot[idx];
@@ -910,6 +971,28 @@ static BYTE get_page_vprot( const void *addr )
 }
 
 
+/***********************************************************************
+ *           get_vprot_bytes_size
+ *
+ * Return the number of bytes equal to vprot under mask.
+ */
+static SIZE_T get_vprot_bytes_size( const BYTE *ptr, SIZE_T count, BYTE vprot, BYTE mask )
+{
+    static const UINT_PTR word_from_byte = (UINT_PTR)0x101010101010101;
+    static const UINT_PTR index_align_mask = sizeof(UINT_PTR) - 1;
+    UINT_PTR vprot_word = word_from_byte * vprot, mask_word = word_from_byte * mask;
+    SIZE_T i = 0;
+
+    for (; i < count && ((UINT_PTR)(ptr + i) & index_align_mask); i++)
+        if ((vprot ^ ptr[i]) & mask) return i;
+    for (; i + sizeof(UINT_PTR) <= count; i += sizeof(UINT_PTR))
+        if ((vprot_word ^ *(const UINT_PTR *)(ptr + i)) & mask_word) break;
+    for (; i < count; i++)
+        if ((vprot ^ ptr[i]) & mask) break;
+    return i;
+}
+
+
 /***********************************************************************
  *           get_vprot_range_size
  *
@@ -920,48 +1003,32 @@ static BYTE get_page_vprot( const void *addr )
  * vprot bytes are allocated for the range. */
 static SIZE_T get_vprot_range_size( char *base, SIZE_T size, BYTE mask, BYTE *vprot )
 {
-    static const UINT_PTR word_from_byte = (UINT_PTR)0x101010101010101;
-    static const UINT_PTR index_align_mask = sizeof(UINT_PTR) - 1;
-    SIZE_T curr_idx, start_idx, end_idx, aligned_start_idx;
-    UINT_PTR vprot_word, mask_word;
-    const BYTE *vprot_ptr;
+    SIZE_T curr_idx, start_idx, end_idx;
 
     TRACE("base %p, size %p, mask %#x.\n", base, (void *)size, mask);
 
     curr_idx = start_idx = (size_t)base >> page_shift;
     end_idx = start_idx + (size >> page_shift);
-
-    aligned_start_idx = (start_idx + index_align_mask) & ~index_align_mask;
-    if (aligned_start_idx > end_idx) aligned_start_idx = end_idx;
+    *vprot = get_page_vprot( base );
 
 #ifdef _WIN64
-    vprot_ptr = pages_vprot[curr_idx >> pages_vprot_shift] + (curr_idx & pages_vprot_mask);
-#else
-    vprot_ptr = pages_vprot + curr_idx;
-#endif
-    *vprot = *vprot_ptr;
-
-    /* Page count page table is at least the multiples of sizeof(UINT_PTR)
-     * so we don't have to worry about crossing the boundary on unaligned idx values. */
-
-    for (; curr_idx < aligned_start_idx; ++curr_idx, ++vprot_ptr)
-        if ((*vprot ^ *vprot_ptr) & mask) return (curr_idx - start_idx) << page_shift;
-
-    vprot_word = word_from_byte * *vprot;
-    mask_word = word_from_byte * mask;
-    for (; curr_idx < end_idx; curr_idx += sizeof(UINT_PTR), vprot_ptr += sizeof(UINT_PTR))
+    while (curr_idx < end_idx)
     {
-#ifdef _WIN64
-        if (!(curr_idx & pages_vprot_mask)) vprot_ptr = pages_vprot[curr_idx >> pages_vprot_shift];
-#endif
-        if ((vprot_word ^ *(UINT_PTR *)vprot_ptr) & mask_word)
-        {
-            for (; curr_idx < end_idx; ++curr_idx, ++vprot_ptr)
-                if ((*vprot ^ *vprot_ptr) & mask) break;
-            return (curr_idx - start_idx) << page_shift;
-        }
+        size_t i = curr_idx >> pages_vprot_shift;
+        SIZE_T count = min( end_idx - curr_idx, pages_vprot_mask + 1 - (curr_idx & pages_vprot_mask) );
+        SIZE_T len;
+
+        if (pages_vprot_fill[i] & VPROT_CHUNK_MIXED)
+            len = get_vprot_bytes_size( pages_vprot[i] + (curr_idx & pages_vprot_mask), count, *vprot, mask );
+        else
+            len = ((pages_vprot_fill[i] ^ *vprot) & mask) ? 0 : count;
+        curr_idx += len;
+        if (len < count) break;
     }
-    return size;
+#else
+    curr_idx += get_vprot_bytes_size( pages_vprot + curr_idx, end_idx - curr_idx, *vprot, mask );
+#endif
+    return (curr_idx - start_idx) << page_shift;
 }
 
 /***********************************************************************
@@ -975,13 +1042,16 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
 #ifdef _WIN64
-    while (idx >> pages_vprot_shift != end >> pages_vprot_shift)
+    while (idx < end)
     {
-        size_t dir_size = pages_vprot_mask + 1 - (idx & pages_vprot_mask);
-        memset( pages_vprot[idx >> pages_vprot_shift] + (idx & pages_vprot_mask), vprot, dir_size );
+        size_t dir_size = min( end - idx, pages_vprot_mask + 1 - (idx & pages_vprot_mask) );
+
+        if (dir_size == pages_vprot_mask + 1)
+            set_vprot_chunk_fill( idx, vprot );
+        else if (pages_vprot_fill[idx >> pages_vprot_shift] != vprot)
+            memset( get_vprot_chunk( idx ) + (idx & pages_vprot_mask), vprot, dir_size );
         idx += dir_size;
     }
-    memset( pages_vprot[idx >> pages_vprot_shift] + (idx & pages_vprot_mask), vprot, end - idx );
 #else
     memset( pages_vprot + idx, vprot, end - idx );
 #endif
@@ -999,10 +1069,20 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
 #ifdef _WIN64
-    for ( ; idx < end; idx++)
+    while (idx < end)
     {
-        BYTE *ptr = pages_vprot[idx >> pages_vprot_shift] + (idx & pages_vprot_mask);
-        *ptr = (*ptr & ~clear) | set;
+        size_t i = idx >> pages_vprot_shift, j = idx & pages_vprot_mask;
+        size_t k, dir_size = min( end - idx, pages_vprot_mask + 1 - j );
+        WORD fill = pages_vprot_fill[i];
+
+        if (!(fill & VPROT_CHUNK_MIXED) && dir_size == pages_vprot_mask + 1)
+            pages_vprot_fill[i] = (BYTE)((fill & ~clear) | set);
+        else if ((fill & VPROT_CHUNK_MIXED) || (BYTE)((fill & ~clear) | set) != fill)
+        {
+            BYTE *ptr = get_vprot_chunk( idx ) + j;
+            for (k = 0; k < dir_size; k++) ptr[k] = (ptr[k] & ~clear) | set;
+        }
+        idx += dir_size;
     }
 #else
     for ( ; idx < end; idx++) pages_vprot[idx] = (pages_vprot[idx] & ~clear) | set;
@@ -1519,7 +1599,10 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
     }
 
     if (vprot & VPROT_WRITEWATCH && use_kernel_writewatch)
+    {
+        if (use_uffd_writewatch) register_uffd_write_watches( view->base, view->size );
         reset_write_watches( view->base, view->size );
+    }
 
     return STATUS_SUCCESS;
 }
@@ -1616,22 +1699,22 @@ static inline int mprotect_exec( void *base, size_t size, int unix_prot )
  */
 static void mprotect_range( void *base, size_t size, BYTE set, BYTE clear )
 {
-    size_t i, count;
-    char *addr = ROUND_ADDR( base, page_mask );
-    int prot, next;
+    char *addr = ROUND_ADDR( base, page_mask ), *start = addr, *end;
+    SIZE_T range_size;
+    int prot = -1, next;
+    BYTE vprot;
 
-    size = ROUND_SIZE( base, size );
-    prot = get_unix_prot( (get_page_vprot( addr ) & ~clear ) | set );
-    for (count = i = 1; i < size >> page_shift; i++, count++)
+    end = addr + ROUND_SIZE( base, size );
+    for (; addr < end; addr += range_size)
     {
-        next = get_unix_prot( (get_page_vprot( addr + (count << page_shift) ) & ~clear) | set );
+        range_size = get_vprot_range_size( addr, end - addr, 0xff, &vprot );
+        next = get_unix_prot( (vprot & ~clear) | set );
         if (next == prot) continue;
-        mprotect_exec( addr, count << page_shift, prot );
-        addr += count << page_shift;
+        if (addr > start) mprotect_exec( start, addr - start, prot );
+        start = addr;
         prot = next;
-        count = 0;
     }
-    if (count) mprotect_exec( addr, count << page_shift, prot );
+    if (addr > start) mprotect_exec( start, addr - start, prot );
 }
 
 
@@ -1683,6 +1766,140 @@ static NTSTATUS set_protection( struct file_view *view, void *base, SIZE_T size,
 }
 
 
+#if defined(HAVE_LINUX_USERFAULTFD_H) && defined(UFFD_FEATURE_WP_ASYNC) && defined(PAGEMAP_SCAN)
+
+/***********************************************************************
+ *           init_uffd_write_watches
+ *
+ * Check if the kernel supports asynchronous userfaultfd write protection
+ * and PAGEMAP_SCAN, which allows tracking writes without any page faults
+ * being delivered to us.
+ */
+static BOOL init_uffd_write_watches(void)
+{
+    static const __u64 features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    struct uffdio_api api = { .api = UFFD_API, .features = features };
+    struct pm_scan_arg arg = { .size = sizeof(arg) };
+    int fd, scan_fd;
+
+    if ((fd = syscall( __NR_userfaultfd, UFFD_USER_MODE_ONLY | O_CLOEXEC | O_NONBLOCK )) == -1)
+        return FALSE;
+    if (ioctl( fd, UFFDIO_API, &api ) == -1 || (api.features & features) != features)
+    {
+        TRACE( "userfaultfd async write protection not supported\n" );
+        close( fd );
+        return FALSE;
+    }
+    if ((scan_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1)
+    {
+        close( fd );
+        return FALSE;
+    }
+    /* an empty scan fails with ENOTTY if PAGEMAP_SCAN is not implemented */
+    if (ioctl( scan_fd, PAGEMAP_SCAN, &arg ) == -1)
+    {
+        TRACE( "PAGEMAP_SCAN not supported, error %s\n", strerror(errno) );
+        close( scan_fd );
+        close( fd );
+        return FALSE;
+    }
+    uffd_fd = fd;
+    pagemap_fd = scan_fd;
+    use_uffd_writewatch = TRUE;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           register_uffd_write_watches
+ *
+ * Enable write-protect tracking on a range. This needs to be done again
+ * whenever the range gets remapped.
+ */
+static void register_uffd_write_watches( void *base, SIZE_T size )
+{
+    struct uffdio_register reg =
+    {
+        .range = { .start = (ULONG_PTR)base, .len = size },
+        .mode = UFFDIO_REGISTER_MODE_WP
+    };
+
+    if (ioctl( uffd_fd, UFFDIO_REGISTER, &reg ) == -1)
+        ERR( "failed to register %p-%p, error %s\n", base, (char *)base + size, strerror(errno) );
+}
+
+
+/***********************************************************************
+ *           reset_uffd_write_watches
+ */
+static void reset_uffd_write_watches( void *base, SIZE_T size )
+{
+    struct uffdio_writeprotect wp =
+    {
+        .range = { .start = (ULONG_PTR)base, .len = size },
+        .mode = UFFDIO_WRITEPROTECT_MODE_WP
+    };
+
+    if (ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp ) == -1)
+        ERR( "failed to write-protect %p-%p, error %s\n", base, (char *)base + size, strerror(errno) );
+}
+
+
+/***********************************************************************
+ *           get_uffd_write_watches
+ *
+ * Retrieve the written pages of a range, optionally write-protecting them
+ * again in the same pass.
+ */
+static NTSTATUS get_uffd_write_watches( char *base, char *end, void **addresses, ULONG_PTR *count, BOOL reset )
+{
+    static struct page_region regions[PAGE_FLAGS_BUFFER_LENGTH];
+    struct pm_scan_arg arg = { .size = sizeof(arg) };
+    ULONG_PTR pos = 0;
+    char *addr;
+    int i, ret;
+
+    arg.flags         = reset ? PM_SCAN_WP_MATCHING : 0;
+    arg.vec           = (ULONG_PTR)regions;
+    arg.vec_len       = ARRAY_SIZE(regions);
+    arg.category_mask = PAGE_IS_WRITTEN;
+    arg.return_mask   = PAGE_IS_WRITTEN;
+    arg.start         = (ULONG_PTR)base;
+    arg.end           = (ULONG_PTR)end;
+
+    while (pos < *count && arg.start < arg.end)
+    {
+        arg.max_pages = *count - pos;
+        if ((ret = ioctl( pagemap_fd, PAGEMAP_SCAN, &arg )) == -1)
+        {
+            ERR( "PAGEMAP_SCAN failed for %p-%p, error %s\n", base, end, strerror(errno) );
+            return STATUS_INVALID_ADDRESS;
+        }
+        for (i = 0; i < ret; i++)
+            for (addr = (char *)(ULONG_PTR)regions[i].start;
+                 addr < (char *)(ULONG_PTR)regions[i].end && pos < *count; addr += page_size)
+                addresses[pos++] = addr;
+        if (arg.walk_end <= arg.start) break;
+        arg.start = arg.walk_end;
+    }
+    *count = pos;
+    return STATUS_SUCCESS;
+}
+
+#else
+
+static inline BOOL init_uffd_write_watches(void) { return FALSE; }
+static inline void register_uffd_write_watches( void *base, SIZE_T size ) { }
+static inline void reset_uffd_write_watches( void *base, SIZE_T size ) { }
+static inline NTSTATUS get_uffd_write_watches( char *base, char *end, void **addresses, ULONG_PTR *count,
+                                               BOOL reset )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif
+
+
 /***********************************************************************
  *           update_write_watches
  */
@@ -1703,7 +1920,11 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
  */
 static void reset_write_watches( void *base, SIZE_T size )
 {
-    if (use_kernel_writewatch)
+    if (use_uffd_writewatch)
+    {
+        reset_uffd_write_watches( base, size );
+    }
+    else if (use_kernel_writewatch)
     {
         char buffer[17];
         ssize_t ret;
@@ -2267,6 +2488,9 @@ static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t siz
     if (anon_mmap_fixed( (char *)view->base + start, size, PROT_NONE, 0 ) != MAP_FAILED)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
+        /* the new mapping is no longer tracked */
+        if (use_uffd_writewatch && (view->protect & VPROT_WRITEWATCH))
+            register_uffd_write_watches( (char *)view->base + start, size );
         return STATUS_SUCCESS;
     }
     return STATUS_NO_MEMORY;
@@ -2361,6 +2585,41 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
 }
 
 
+/***********************************************************************
+ *           set_image_protections
+ *
+ * Set the page protections of the header and sections of a mapped image.
+ * virtual_mutex must be held by caller.
+ */
+static void set_image_protections( struct file_view *view, const IMAGE_SECTION_HEADER *sec, int count,
+                                   SIZE_T header_size, const WCHAR *filename )
+{
+    char *ptr = view->base;
+    int i;
+
+    set_vprot( view, ptr, ROUND_SIZE( 0, header_size ), VPROT_COMMITTED | VPROT_READ );
+
+    for (i = 0; i < count; i++, sec++)
+    {
+        SIZE_T size;
+        BYTE vprot = VPROT_COMMITTED;
+
+        if (sec->Misc.VirtualSize)
+            size = ROUND_SIZE( sec->VirtualAddress, sec->Misc.VirtualSize );
+        else
+            size = ROUND_SIZE( sec->VirtualAddress, sec->SizeOfRawData );
+
+        if (sec->Characteristics & IMAGE_SCN_MEM_READ)    vprot |= VPROT_READ;
+        if (sec->Characteristics & IMAGE_SCN_MEM_WRITE)   vprot |= VPROT_WRITECOPY;
+        if (sec->Characteristics & IMAGE_SCN_MEM_EXECUTE) vprot |= VPROT_EXEC;
+
+        if (!set_vprot( view, ptr + sec->VirtualAddress, size, vprot ) && (vprot & VPROT_EXEC))
+            ERR( "failed to set %08x protection on %s section %.8s, noexec filesystem?\n",
+                 sec->Characteristics, debugstr_w(filename), sec->Name );
+    }
+}
+
+
 /***********************************************************************
  *           map_image_into_view
  *
@@ -2368,7 +2627,8 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
  * virtual_mutex must be held by caller.
  */
 static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filename, int fd, void *orig_base,
-                                     SIZE_T header_size, ULONG image_flags, int shared_fd, BOOL removable )
+                                     SIZE_T header_size, ULONG image_flags, int shared_fd, int aligned_fd,
+                                     BOOL removable )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
@@ -2377,7 +2637,7 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
     IMAGE_DATA_DIRECTORY *imports;
     NTSTATUS status = STATUS_CONFLICTING_ADDRESSES;
     int i;
-    off_t pos;
+    off_t pos, aligned_pos = 0;
     struct stat st;
     char *header_end, *header_start;
     char *ptr = view->base;
@@ -2498,14 +2758,37 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
 
         if (!sec->PointerToRawData || !file_size) continue;
 
-        /* Note: if the section is not aligned properly map_file_into_view will magically
-         *       fall back to read(), so we don't need to check anything here.
-         */
         end = file_start + file_size;
         if (sec->PointerToRawData >= st.st_size ||
             end > ((st.st_size + sector_align) & ~sector_align) ||
-            end < file_start ||
-            map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
+            end < file_start)
+        {
+            ERR_(module)( "Could not map %s section %.8s, file probably truncated\n",
+                          debugstr_w(filename), sec->Name );
+            return status;
+        }
+
+        /* the server stores a page-aligned copy of unaligned sections in a read-only file */
+        if (aligned_fd != -1 && (file_start & page_mask))
+        {
+            SIZE_T size = min( ROUND_SIZE( 0, file_size ), map_size );
+
+            TRACE_(module)( "%s mapping unaligned section %.8s from aligned file off %x\n",
+                            debugstr_w(filename), sec->Name, (int)aligned_pos );
+            if (map_file_into_view( view, aligned_fd, sec->VirtualAddress, size, aligned_pos,
+                                    VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) != STATUS_SUCCESS)
+            {
+                ERR_(module)( "Could not map %s section %.8s\n", debugstr_w(filename), sec->Name );
+                return status;
+            }
+            aligned_pos += ROUND_SIZE( 0, file_size );
+            continue;
+        }
+
+        /* Note: if the section is not aligned properly map_file_into_view will magically
+         *       fall back to read(), so we don't need to check anything here.
+         */
+        if (map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
                                 VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
                                 removable ) != STATUS_SUCCESS)
         {
@@ -2525,42 +2808,349 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         }
     }
 
-    /* set the image protections */
+    set_image_protections( view, sections, nt->FileHeader.NumberOfSections, header_size, filename );
 
-    set_vprot( view, ptr, ROUND_SIZE( 0, header_size ), VPROT_COMMITTED | VPROT_READ );
+#ifdef VALGRIND_LOAD_PDB_DEBUGINFO
+    VALGRIND_LOAD_PDB_DEBUGINFO(fd, ptr, total_size, ptr - (char *)orig_base);
+#endif
+    return STATUS_SUCCESS;
+}
 
-    sec = sections;
-    for (i = 0; i < nt->FileHeader.NumberOfSections; i++, sec++)
+
+/***********************************************************************
+ *           read_reloc_cache_header
+ *
+ * Read the header of an image file, as it should look once the image is
+ * relocated to base. The size is updated to the number of bytes read.
+ * The caller must free the returned buffer.
+ */
+static void *read_reloc_cache_header( int fd, SIZE_T *size, void *base )
+{
+    IMAGE_DOS_HEADER *dos;
+    IMAGE_NT_HEADERS *nt;
+    struct stat st;
+    SIZE_T header_size;
+    void *header;
+
+    if (fstat( fd, &st ) == -1) return NULL;
+    header_size = min( *size, st.st_size );
+    if (header_size < sizeof(*dos) || header_size > 16 * page_size) return NULL;
+    if (!(header = malloc( header_size ))) return NULL;
+    if (pread( fd, header, header_size, 0 ) != header_size) goto failed;
+    dos = header;
+    if (dos->e_lfanew < 0 || dos->e_lfanew + sizeof(*nt) > header_size) goto failed;
+    nt = (IMAGE_NT_HEADERS *)((char *)header + dos->e_lfanew);
+    if (nt->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR_MAGIC) goto failed;
+    nt->OptionalHeader.ImageBase = (ULONG_PTR)base;
+    *size = header_size;
+    return header;
+
+failed:
+    free( header );
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           get_reloc_cache_path
+ *
+ * Build the name of the relocated image cache file for a given image file
+ * and load address. The name includes a hash of the image header and of
+ * the Wine build, so that a rebuilt or rewritten file never matches an old
+ * entry. Only files owned by the current user are cached.
+ * The caller must free the returned string.
+ */
+static char *get_reloc_cache_path( int fd, const void *header, SIZE_T header_size, void *base )
+{
+    const unsigned char *p;
+    ULONG64 hash = 0xcbf29ce484222325ull;  /* FNV-1a */
+    unsigned long mtime_nsec = 0;
+    struct stat st;
+    char *path;
+    SIZE_T i;
+
+    if (fstat( fd, &st ) == -1 || st.st_uid != getuid()) return NULL;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime_nsec = st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime_nsec = st.st_mtimespec.tv_nsec;
+#endif
+    for (p = (const unsigned char *)wine_build; *p; p++) hash = (hash ^ *p) * 0x100000001b3ull;
+    for (i = 0, p = header; i < header_size; i++) hash = (hash ^ p[i]) * 0x100000001b3ull;
+
+    if (!(path = malloc( strlen( reloc_cache_dir ) + 10 * 17 ))) return NULL;
+    sprintf( path, "%s/v%u-%08x%08x-%lx-%lx-%lx-%lx.%lx-%lx-%lx", reloc_cache_dir, RELOC_CACHE_VERSION,
+             (UINT)(hash >> 32), (UINT)hash, (unsigned long)st.st_dev, (unsigned long)st.st_ino,
+             (unsigned long)st.st_size, (unsigned long)st.st_mtime, mtime_nsec,
+             (unsigned long)st.st_ctime, (unsigned long)base );
+    return path;
+}
+
+
+struct reloc_cache_entry
+{
+    time_t mtime;
+    off_t  size;
+    char  *name;
+};
+
+static int compare_reloc_cache_entries( const void *p1, const void *p2 )
+{
+    const struct reloc_cache_entry *e1 = p1, *e2 = p2;
+
+    if (e1->mtime != e2->mtime) return e1->mtime < e2->mtime ? -1 : 1;
+    return 0;
+}
+
+/***********************************************************************
+ *           trim_reloc_cache
+ *
+ * Remove the least recently used entries until the cache fits in its size limit.
+ * Entries are touched every time they are used, so their mtime tells how
+ * recently they were used.
+ */
+static void trim_reloc_cache(void)
+{
+    struct reloc_cache_entry *entries = NULL, *new_entries;
+    unsigned int i, count = 0, capacity = 0;
+    unsigned long long total = 0;
+    char path[PATH_MAX];
+    struct dirent *de;
+    struct stat st;
+    DIR *dir;
+
+    if (!(dir = opendir( reloc_cache_dir ))) return;
+    while ((de = readdir( dir )))
     {
-        SIZE_T size;
-        BYTE vprot = VPROT_COMMITTED;
+        if (de->d_name[0] != 'v') continue;
+        if (snprintf( path, sizeof(path), "%s/%s", reloc_cache_dir, de->d_name ) >= sizeof(path)) continue;
+        if (lstat( path, &st ) == -1 || !S_ISREG( st.st_mode )) continue;
+        if (count == capacity)
+        {
+            capacity = max( 64, capacity * 2 );
+            if (!(new_entries = realloc( entries, capacity * sizeof(*entries) ))) break;
+            entries = new_entries;
+        }
+        if (!(entries[count].name = strdup( path ))) break;
+        entries[count].mtime = st.st_mtime;
+        entries[count].size = st.st_size;
+        total += st.st_size;
+        count++;
+    }
+    closedir( dir );
 
-        if (sec->Misc.VirtualSize)
-            size = ROUND_SIZE( sec->VirtualAddress, sec->Misc.VirtualSize );
-        else
-            size = ROUND_SIZE( sec->VirtualAddress, sec->SizeOfRawData );
+    if (total > RELOC_CACHE_MAX_SIZE)
+    {
+        qsort( entries, count, sizeof(*entries), compare_reloc_cache_entries );
+        for (i = 0; i < count && total > RELOC_CACHE_MAX_SIZE; i++)
+        {
+            TRACE_(module)( "cache full, removing %s\n", debugstr_a(entries[i].name) );
+            if (!unlink( entries[i].name )) total -= entries[i].size;
+        }
+    }
 
-        if (sec->Characteristics & IMAGE_SCN_MEM_READ)    vprot |= VPROT_READ;
-        if (sec->Characteristics & IMAGE_SCN_MEM_WRITE)   vprot |= VPROT_WRITECOPY;
-        if (sec->Characteristics & IMAGE_SCN_MEM_EXECUTE) vprot |= VPROT_EXEC;
+    for (i = 0; i < count; i++) free( entries[i].name );
+    free( entries );
+}
 
-        if (!set_vprot( view, ptr + sec->VirtualAddress, size, vprot ) && (vprot & VPROT_EXEC))
-            ERR( "failed to set %08x protection on %s section %.8s, noexec filesystem?\n",
-                 sec->Characteristics, debugstr_w(filename), sec->Name );
+
+/***********************************************************************
+ *           get_relocatable_nt
+ *
+ * Return the NT header of a mapped image if it can be relocated by the cache.
+ */
+static IMAGE_NT_HEADERS *get_relocatable_nt( struct file_view *view, SIZE_T header_size )
+{
+    IMAGE_DOS_HEADER *dos = view->base;
+    IMAGE_NT_HEADERS *nt;
+    IMAGE_DATA_DIRECTORY *relocs;
+    IMAGE_SECTION_HEADER *sec;
+    int i;
+
+    if (header_size > view->size || dos->e_lfanew < 0 ||
+        dos->e_lfanew + sizeof(*nt) > header_size) return NULL;
+    nt = (IMAGE_NT_HEADERS *)((char *)view->base + dos->e_lfanew);
+    if (nt->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR_MAGIC) return NULL;
+    if (!(nt->FileHeader.Characteristics & IMAGE_FILE_DLL)) return NULL;
+    if (nt->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED) return NULL;
+    if (nt->FileHeader.NumberOfSections > 96) return NULL;
+    if (nt->OptionalHeader.SectionAlignment < page_size) return NULL;
+    if (nt->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return NULL;
+    relocs = &nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    if (!relocs->VirtualAddress || !relocs->Size) return NULL;
+    if (relocs->VirtualAddress >= view->size || relocs->Size > view->size - relocs->VirtualAddress) return NULL;
+    sec = (IMAGE_SECTION_HEADER *)((char *)&nt->OptionalHeader + nt->FileHeader.SizeOfOptionalHeader);
+    if ((char *)(sec + nt->FileHeader.NumberOfSections) > (char *)view->base + header_size) return NULL;
+    /* shared sections must stay mapped from the server's shared file */
+    for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
+        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) && (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE))
+            return NULL;
+    return nt;
+}
+
+
+/***********************************************************************
+ *           map_image_from_reloc_cache
+ *
+ * Map an image that has been relocated to this address by a previous
+ * process. The pages are backed by the cache file, so they are shared
+ * between all processes that load the image at the same address.
+ * The cached header must match the one of the real file.
+ * virtual_mutex must be held by caller.
+ */
+static NTSTATUS map_image_from_reloc_cache( struct file_view *view, int fd, SIZE_T header_size,
+                                            const WCHAR *filename )
+{
+    IMAGE_SECTION_HEADER sections[96];
+    IMAGE_NT_HEADERS *nt;
+    SIZE_T size = header_size;
+    struct stat st;
+    NTSTATUS status;
+    void *header;
+    char *path;
+    int cache_fd;
+
+    if (!(header = read_reloc_cache_header( fd, &size, view->base ))) return STATUS_UNSUCCESSFUL;
+    if (!(path = get_reloc_cache_path( fd, header, size, view->base )))
+    {
+        free( header );
+        return STATUS_UNSUCCESSFUL;
+    }
+    cache_fd = open( path, O_RDONLY | O_NOFOLLOW );
+    free( path );
+    if (cache_fd == -1)
+    {
+        free( header );
+        return STATUS_UNSUCCESSFUL;
     }
 
-#ifdef VALGRIND_LOAD_PDB_DEBUGINFO
-    VALGRIND_LOAD_PDB_DEBUGINFO(fd, ptr, total_size, ptr - (char *)orig_base);
+    if (fstat( cache_fd, &st ) == -1 || !S_ISREG( st.st_mode ) || st.st_uid != getuid() ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) || st.st_size != view->size)
+        status = STATUS_UNSUCCESSFUL;
+    else
+        status = map_file_into_view( view, cache_fd, 0, view->size, 0,
+                                     VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE );
+    /* update the modification time to keep recently used entries in the cache */
+#ifdef HAVE_FUTIMENS
+    if (!status) futimens( cache_fd, NULL );
+#elif defined(HAVE_FUTIMES)
+    if (!status) futimes( cache_fd, NULL );
 #endif
+    close( cache_fd );
+    if (status)
+    {
+        free( header );
+        return status;
+    }
+
+    set_vprot( view, view->base, view->size, VPROT_COMMITTED | VPROT_READ | VPROT_EXEC | VPROT_WRITECOPY );
+    if (!(nt = get_relocatable_nt( view, header_size )) ||
+        size > view->size || memcmp( view->base, header, size ))
+    {
+        WARN_(module)( "invalid cached image for %s at %p\n", debugstr_w(filename), view->base );
+        free( header );
+        return STATUS_UNSUCCESSFUL;
+    }
+    free( header );
+    TRACE_(module)( "mapped cached relocated image for %s at %p\n", debugstr_w(filename), view->base );
+
+    memcpy( sections, (char *)&nt->OptionalHeader + nt->FileHeader.SizeOfOptionalHeader,
+            nt->FileHeader.NumberOfSections * sizeof(*sections) );
+    set_image_protections( view, sections, nt->FileHeader.NumberOfSections, header_size, filename );
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           add_image_to_reloc_cache
+ *
+ * Relocate an image that has been mapped away from its preferred base, and
+ * store the result in the cache so that other processes can share it.
+ * The ImageBase of the header is updated like the Windows loader does, so
+ * that the PE loader doesn't apply the relocations a second time.
+ * Returns an error if the view contents have been left in an inconsistent
+ * state, in which case the image needs to be mapped again.
+ * virtual_mutex must be held by caller.
+ */
+static NTSTATUS add_image_to_reloc_cache( struct file_view *view, int fd, SIZE_T header_size,
+                                          const WCHAR *filename, BOOL *added )
+{
+    IMAGE_SECTION_HEADER sections[96];
+    const IMAGE_BASE_RELOCATION *rel, *end;
+    IMAGE_NT_HEADERS *nt;
+    SIZE_T size = header_size;
+    char *path, *tmp;
+    void *header;
+    int cache_fd;
+    INT_PTR delta;
+
+    *added = FALSE;
+    if (!(nt = get_relocatable_nt( view, header_size ))) return STATUS_SUCCESS;
+    if (!(header = read_reloc_cache_header( fd, &size, view->base ))) return STATUS_SUCCESS;
+    path = get_reloc_cache_path( fd, header, size, view->base );
+    free( header );
+    if (!path) return STATUS_SUCCESS;
+    if (!(tmp = malloc( strlen( path ) + 12 )))
+    {
+        free( path );
+        return STATUS_SUCCESS;
+    }
+    memcpy( sections, (char *)&nt->OptionalHeader + nt->FileHeader.SizeOfOptionalHeader,
+            nt->FileHeader.NumberOfSections * sizeof(*sections) );
+
+    TRACE_(module)( "relocating %s to %p for the cache\n", debugstr_w(filename), view->base );
+
+    mprotect( view->base, view->size, PROT_READ | PROT_WRITE );
+    rel = (const IMAGE_BASE_RELOCATION *)((char *)view->base +
+                                          nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress);
+    end = (const IMAGE_BASE_RELOCATION *)((const char *)rel +
+                                          nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size);
+    delta = (char *)view->base - (char *)nt->OptionalHeader.ImageBase;
+    while (rel < end - 1 && rel->SizeOfBlock)
+    {
+        if (rel->VirtualAddress >= view->size ||
+            !(rel = process_relocation_block( view->base, rel, delta )))
+        {
+            WARN_(module)( "failed to relocate %s, not caching it\n", debugstr_w(filename) );
+            free( path );
+            free( tmp );
+            return STATUS_INVALID_IMAGE_FORMAT;
+        }
+    }
+    nt->OptionalHeader.ImageBase = (ULONG_PTR)view->base;
+
+    /* a stale temporary file can only be left by a dead process with the same pid */
+    sprintf( tmp, "%s.%u", path, getpid() );
+    unlink( tmp );
+    if ((cache_fd = open( tmp, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW, 0600 )) != -1)
+    {
+        if (write( cache_fd, view->base, view->size ) == view->size && !rename( tmp, path ))
+        {
+            /* replace the private pages by the shared ones */
+            map_file_into_view( view, cache_fd, 0, view->size, 0,
+                                VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE );
+            *added = TRUE;
+        }
+        else unlink( tmp );
+        close( cache_fd );
+    }
+    else WARN_(module)( "failed to create %s: %s\n", debugstr_a(tmp), strerror(errno) );
+
+    free( path );
+    free( tmp );
+    set_vprot( view, view->base, view->size, VPROT_COMMITTED | VPROT_READ | VPROT_EXEC | VPROT_WRITECOPY );
+    set_image_protections( view, sections, nt->FileHeader.NumberOfSections, header_size, filename );
     return STATUS_SUCCESS;
 }
 
 
+
 /***********************************************************************
  *             get_mapping_info
  */
 static NTSTATUS get_mapping_info( HANDLE handle, ACCESS_MASK access, unsigned int *sec_flags,
-                                  mem_size_t *full_size, HANDLE *shared_file, pe_image_info_t **info )
+                                  mem_size_t *full_size, HANDLE *shared_file, HANDLE *aligned_file,
+                                  pe_image_info_t **info )
 {
     pe_image_info_t *image_info;
     SIZE_T total, size = 1024;
@@ -2580,12 +3170,14 @@ static NTSTATUS get_mapping_info( HANDLE handle, ACCESS_MASK access, unsigned in
             *full_size   = reply->size;
             total        = reply->total;
             *shared_file = wine_server_ptr_handle( reply->shared_file );
+            *aligned_file = wine_server_ptr_handle( reply->aligned_file );
         }
         SERVER_END_REQ;
         if (!status && total <= size - sizeof(WCHAR)) break;
         free( image_info );
         if (status) return status;
         if (*shared_file) NtClose( *shared_file );
+        if (*aligned_file) NtClose( *aligned_file );
         size = total + sizeof(WCHAR);
     }
 
@@ -2610,13 +3202,15 @@ static NTSTATUS get_mapping_info( HANDLE handle, ACCESS_MASK access, unsigned in
  * Map a PE image section into memory.
  */
 static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **addr_ptr, SIZE_T *size_ptr,
-                                   ULONG_PTR zero_bits, HANDLE shared_file, ULONG alloc_type,
+                                   ULONG_PTR zero_bits, HANDLE shared_file, HANDLE aligned_file, ULONG alloc_type,
                                    pe_image_info_t *image_info, WCHAR *filename, BOOL is_builtin )
 {
     unsigned int vprot = SEC_IMAGE | SEC_FILE | VPROT_COMMITTED | VPROT_READ | VPROT_EXEC | VPROT_WRITECOPY;
     int unix_fd = -1, needs_close;
     int shared_fd = -1, shared_needs_close = 0;
+    int aligned_fd = -1, aligned_needs_close = 0;
     SIZE_T size = image_info->map_size;
+    BOOL use_cache, cache_added = FALSE;
     struct file_view *view;
     NTSTATUS status;
     sigset_t sigset;
@@ -2632,6 +3226,11 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
         return status;
     }
 
+    /* the aligned sections are only an optimization, fall back to reading the file */
+    if (aligned_file && server_get_unix_fd( aligned_file, FILE_READ_DATA, &aligned_fd,
+                                            &aligned_needs_close, NULL, NULL ))
+        aligned_fd = -1;
+
     status = STATUS_INVALID_PARAMETER;
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
@@ -2644,8 +3243,22 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     if (status) status = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, get_zero_bits_mask( zero_bits ), 0 );
     if (status) goto done;
 
-    status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
-                                  image_info->image_flags, shared_fd, needs_close );
+    /* images relocated by the loader can be shared through the relocated image cache */
+    use_cache = (reloc_cache_dir && view->base != base &&
+                 (is_builtin || (alloc_type & MEM_DIFFERENT_IMAGE_BASE_OK)) &&
+                 !(image_info->image_flags & IMAGE_FLAGS_ImageMappedFlat));
+
+    if (!use_cache || map_image_from_reloc_cache( view, unix_fd, image_info->header_size, filename ))
+    {
+        status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
+                                      image_info->image_flags, shared_fd, aligned_fd, needs_close );
+        if (status == STATUS_SUCCESS && use_cache &&
+            add_image_to_reloc_cache( view, unix_fd, image_info->header_size, filename, &cache_added ))
+            status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
+                                          image_info->image_flags, shared_fd, aligned_fd, needs_close );
+    }
+    else status = STATUS_SUCCESS;
+
     if (status == STATUS_SUCCESS)
     {
         SERVER_START_REQ( map_view )
@@ -2671,6 +3284,8 @@ done:
     server_leave_uninterrupted_section( &virtual_mutex, &sigset );
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
+    if (aligned_needs_close) close( aligned_fd );
+    if (cache_added) trim_reloc_cache();
     return status;
 }
 
@@ -2694,7 +3309,7 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
     int unix_handle = -1, needs_close;
     unsigned int vprot, sec_flags;
     struct file_view *view;
-    HANDLE shared_file;
+    HANDLE shared_file, aligned_file;
     LARGE_INTEGER offset;
     sigset_t sigset;
 
@@ -2720,7 +3335,8 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
         return STATUS_INVALID_PAGE_PROTECTION;
     }
 
-    res = get_mapping_info( handle, access, &sec_flags, &full_size, &shared_file, &image_info );
+    res = get_mapping_info( handle, access, &sec_flags, &full_size, &shared_file, &aligned_file,
+                            &image_info );
     if (res) return res;
 
     if (image_info)
@@ -2730,8 +3346,9 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
         res = load_builtin( image_info, filename, addr_ptr, size_ptr );
         if (res == STATUS_IMAGE_ALREADY_LOADED)
             res = virtual_map_image( handle, access, addr_ptr, size_ptr, zero_bits, shared_file,
-                                     alloc_type, image_info, filename, FALSE );
+                                     aligned_file, alloc_type, image_info, filename, FALSE );
         if (shared_file) NtClose( shared_file );
+        if (aligned_file) NtClose( aligned_file );
         free( image_info );
         return res;
     }
@@ -2849,8 +3466,16 @@ void virtual_init(void)
     pthread_mutex_init( &virtual_mutex, &attr );
     pthread_mutexattr_destroy( &attr );
 
-    if (!((env_var = getenv("WINE_DISABLE_KERNEL_WRITEWATCH")) && atoi(env_var))
-            && (pagemap_reset_fd = open("/proc/self/pagemap_reset", O_RDONLY)) != -1)
+    if ((env_var = getenv("WINE_DISABLE_KERNEL_WRITEWATCH")) && atoi(env_var))
+    {
+        TRACE("kernel write watches disabled.\n");
+    }
+    else if (init_uffd_write_watches())
+    {
+        use_kernel_writewatch = TRUE;
+        TRACE("using userfaultfd write watches.\n");
+    }
+    else if ((pagemap_reset_fd = open("/proc/self/pagemap_reset", O_RDONLY)) != -1)
     {
         use_kernel_writewatch = TRUE;
         if ((pagemap_fd = open("/proc/self/pagemap", O_RDONLY)) == -1)
@@ -2867,6 +3492,18 @@ void virtual_init(void)
             MESSAGE("wine: using kernel write watches (experimental).\n");
     }
 
+    if ((env_var = getenv( "WINE_RELOC_CACHE" )) && *env_var)
+    {
+        struct stat st;
+
+        if (mkdir( env_var, 0700 ) && errno != EEXIST)
+            ERR( "cannot create relocated image cache %s: %s\n", env_var, strerror(errno) );
+        else if (lstat( env_var, &st ) || !S_ISDIR( st.st_mode ) || st.st_uid != getuid() ||
+                 (st.st_mode & (S_IWGRP | S_IWOTH)))
+            ERR( "relocated image cache %s is not a private directory, disabling it\n", env_var );
+        else reloc_cache_dir = env_var;
+    }
+
     if (preload_info && *preload_info)
         for (i = 0; (*preload_info)[i].size; i++)
             mmap_add_reserved_area( (*preload_info)[i].addr, (*preload_info)[i].size );
@@ -2890,7 +3527,7 @@ void virtual_init(void)
     /* try to find space in a reserved area for the views and pages protection table */
 #ifdef _WIN64
     pages_vprot_size = ((size_t)address_space_limit >> page_shift >> pages_vprot_shift) + 1;
-    alloc_views.size = 2 * view_block_size + pages_vprot_size * sizeof(*pages_vprot);
+    alloc_views.size = 2 * view_block_size + pages_vprot_size * (sizeof(*pages_vprot) + sizeof(*pages_vprot_fill));
 #else
     alloc_views.size = 2 * view_block_size + (1U << (32 - page_shift));
 #endif
@@ -2904,6 +3541,9 @@ void virtual_init(void)
     view_block_end = view_block_start + view_block_size / sizeof(*view_block_start);
     free_ranges = (void *)((char *)alloc_views.base + view_block_size);
     pages_vprot = (void *)((char *)alloc_views.base + 2 * view_block_size);
+#ifdef _WIN64
+    pages_vprot_fill = (WORD *)(pages_vprot + pages_vprot_size);
+#endif
     wine_rb_init( &views_tree, compare_view );
 
     free_ranges[0].base = (void *)0;
@@ -2971,13 +3611,14 @@ NTSTATUS virtual_map_builtin_module( HANDLE mapping, void **module, SIZE_T *size
 {
     mem_size_t full_size;
     unsigned int sec_flags;
-    HANDLE shared_file;
+    HANDLE shared_file, aligned_file;
     pe_image_info_t *image_info = NULL;
     ACCESS_MASK access = SECTION_MAP_READ | SECTION_MAP_EXECUTE;
     NTSTATUS status;
     WCHAR *filename;
 
-    if ((status = get_mapping_info( mapping, access, &sec_flags, &full_size, &shared_file, &image_info )))
+    if ((status = get_mapping_info( mapping, access, &sec_flags, &full_size, &shared_file, &aligned_file,
+                                    &image_info )))
         return status;
 
     if (!image_info) return STATUS_INVALID_PARAMETER;
@@ -3004,11 +3645,13 @@ NTSTATUS virtual_map_builtin_module( HANDLE mapping, void **module, SIZE_T *size
     else
     {
         status = virtual_map_image( mapping, SECTION_MAP_READ | SECTION_MAP_EXECUTE,
-                                    module, size, 0, shared_file, 0, image_info, filename, TRUE );
+                                    module, size, 0, shared_file, aligned_file, 0, image_info,
+                                    filename, TRUE );
         virtual_fill_image_information( image_info, info );
     }
 
     if (shared_file) NtClose( shared_file );
+    if (aligned_file) NtClose( aligned_file );
     free( image_info );
     return status;
 }
@@ -5401,7 +6044,13 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
         char *addr = base;
         char *end = addr + size;
 
-        if (use_kernel_writewatch)
+        if (use_uffd_writewatch)
+        {
+            status = get_uffd_write_watches( addr, end, addresses, count, flags & WRITE_WATCH_FLAG_RESET );
+            *granularity = page_size;
+            goto done;
+        }
+        else if (use_kernel_writewatch)
         {
             static UINT64 buffer[PAGE_FLAGS_BUFFER_LENGTH];
             unsigned int i, length;
@@ -2709,6 +2709,51 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/***********************************************************************
+ *           get_shared_posted_message
+ *
+ * Retrieve the oldest posted message from the queue shared memory ring,
+ * without a server round trip. Return FALSE if the ring is empty, or if
+ * the message has to be removed by the server.
+ */
+static BOOL get_shared_posted_message( volatile struct queue_shared_memory *shared,
+                                       volatile struct queue_client_memory *client, UINT flags,
+                                       struct received_message_info *info )
+{
+    volatile struct shared_posted_message *posted;
+    unsigned int read, write;
+
+    for (;;)
+    {
+        read = __SHARED_READ_SEQ( &client->posted_read );
+        write = __SHARED_READ_SEQ( &shared->posted_write );
+        __SHARED_READ_FENCE;
+        if (read == write || write - read > SHARED_POSTED_MESSAGES) return FALSE;
+
+        posted = &shared->posted[read % SHARED_POSTED_MESSAGES];
+        info->type        = MSG_POSTED;
+        info->msg.hwnd    = wine_server_ptr_handle( posted->win );
+        info->msg.message = posted->msg;
+        info->msg.wParam  = posted->wparam;
+        info->msg.lParam  = posted->lparam;
+        info->msg.time    = posted->time;
+        info->msg.pt.x    = posted->x;
+        info->msg.pt.y    = posted->y;
+        __SHARED_READ_FENCE;
+
+        /* the entry is only valid if nobody consumed it while we were copying it */
+        if (!(flags & PM_REMOVE))
+        {
+            if (__SHARED_READ_SEQ( &client->posted_read ) == read) return TRUE;
+        }
+        /* leave the last entry to the server, so that it clears the queue bits when the ring is empty */
+        else if (write - read == 1) return FALSE;
+        else if (InterlockedCompareExchange( (LONG *)&client->posted_read, read + 1, read ) == read)
+            return TRUE;
+    }
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2720,6 +2765,7 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
 {
     LRESULT result;
     volatile struct queue_shared_memory *shared = get_queue_shared_memory();
+    volatile struct queue_client_memory *client = get_queue_client_memory();
     struct user_thread_info *thread_info = get_user_thread_info();
     INPUT_MESSAGE_SOURCE prev_source = thread_info->msg_source;
     struct received_message_info info, *old_info;
@@ -2737,6 +2783,7 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
         NTSTATUS res;
         size_t size = 0;
         const message_data_t *msg_data = buffer;
+        BOOL shared_posted = FALSE;
         UINT wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
         DWORD clear_bits = 0, filter = flags >> 16 ? flags >> 16 : QS_ALLINPUT;
         if (filter & QS_POSTMESSAGE)
@@ -2752,6 +2799,10 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
         if (!shared || waited || GetTickCount() - thread_info->last_getmsg_time >= 3000) skip = FALSE;
         else SHARED_READ_BEGIN( &shared->seq )
         {
+            /* posted messages can be read directly if there are no sent messages and no filter */
+            shared_posted = client && shared->created && !(shared->wake_bits & QS_SENDMESSAGE) &&
+                            (filter & QS_POSTMESSAGE) && !hwnd && !first && last == ~0U;
+
             /* not created yet */
             if (!shared->created) skip = FALSE;
             /* if the masks need an update */
@@ -2769,6 +2820,11 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
         SHARED_READ_END( &shared->seq );
 
         if (skip) res = STATUS_PENDING;
+        else if (shared_posted && get_shared_posted_message( shared, client, flags, &info ))
+        {
+            res = STATUS_SUCCESS;
+            hw_id = 0;
+        }
         else SERVER_START_REQ( get_message )
         {
             req->flags     = flags;
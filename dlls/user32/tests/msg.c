@@ -13005,6 +13005,68 @@ static void test_PeekMessage3(void)
     flush_events();
 }
 
+static void test_posted_message_order(void)
+{
+    DWORD status, wait;
+    HWND hwnd;
+    BOOL ret;
+    MSG msg;
+    int i;
+
+    hwnd = CreateWindowA("TestWindowClass", "posted order", WS_OVERLAPPEDWINDOW,
+                         10, 10, 100, 100, NULL, NULL, NULL, NULL);
+    ok(hwnd != NULL, "expected hwnd != NULL\n");
+    flush_events();
+
+    /* unfiltered peeks right after posting */
+    for (i = 0; i < 10; i++)
+    {
+        PostMessageA(hwnd, WM_USER, i, 0);
+        ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+        ok(ret && msg.hwnd == hwnd && msg.message == WM_USER && msg.wParam == i,
+           "%d: got %p %u %lu\n", i, msg.hwnd, msg.message, msg.wParam);
+    }
+    for (i = 0; i < 10; i++) PostMessageA(hwnd, WM_USER, i, 0);
+    for (i = 0; i < 10; i++)
+    {
+        ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+        ok(ret && msg.message == WM_USER && msg.wParam == i, "%d: got %u %lu\n", i, msg.message, msg.wParam);
+    }
+    /* the queue status must not report the messages that were just removed */
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(!(HIWORD(status) & QS_POSTMESSAGE), "got status %#lx\n", status);
+    wait = MsgWaitForMultipleObjects(0, NULL, FALSE, 0, QS_POSTMESSAGE);
+    ok(wait == WAIT_TIMEOUT, "MsgWaitForMultipleObjects returned %#lx\n", wait);
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    for (i = 0; i < 200; i++) PostMessageA(hwnd, WM_USER + (i % 2), i, 0);
+
+    /* a filtered peek has to find messages behind the ones the unfiltered peeks return */
+    ret = PeekMessageA(&msg, hwnd, WM_USER + 1, WM_USER + 1, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1 && msg.wParam == 1, "got %u %lu\n", msg.message, msg.wParam);
+    for (i = 0; i < 200; i++)
+    {
+        if (i == 1) continue;
+        ret = PeekMessageA(&msg, NULL, 0, 0, (i % 3) ? PM_REMOVE : PM_NOREMOVE);
+        ok(ret && msg.message == WM_USER + (i % 2) && msg.wParam == i,
+           "%d: got %u %lu\n", i, msg.message, msg.wParam);
+        if (!(i % 3))
+        {
+            ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+            ok(ret && msg.wParam == i, "%d: got %u %lu\n", i, msg.message, msg.wParam);
+        }
+        if (i == 100) PostMessageA(hwnd, WM_USER + 2, 0, 0);
+    }
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 2, "got %u %lu\n", msg.message, msg.wParam);
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+    ok(!ret, "expected PeekMessage to return FALSE, got %u\n", ret);
+
+    DestroyWindow(hwnd);
+    flush_events();
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -18854,6 +18916,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_posted_message_order();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -9725,6 +9725,145 @@ todo_wine
     ok(ret, "UnregisterClass(my_window) failed\n");
 }
 
+static void test_window_from_point_many_children(void)
+{
+    HWND hwnd, hwnd2, child[128], win;
+    POINT pt;
+    int i;
+
+    hwnd = CreateWindowExA(0, "MainWindowClass", NULL, WS_POPUP | WS_VISIBLE,
+            100, 100, 320, 160, 0, 0, NULL, NULL);
+    ok(hwnd != 0, "CreateWindowEx failed\n");
+
+    pt.x = 105;
+    pt.y = 105;
+    win = WindowFromPoint(pt);
+    if (win != hwnd)
+    {
+        skip("there's another window covering test window\n");
+        DestroyWindow(hwnd);
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(child); i++)
+    {
+        child[i] = CreateWindowExA(0, "button", "button", WS_CHILD | WS_VISIBLE,
+                (i % 16) * 20, (i / 16) * 20, 20, 20, hwnd, 0, NULL, NULL);
+        ok(child[i] != 0, "CreateWindowEx failed\n");
+    }
+
+    for (i = 0; i < ARRAY_SIZE(child); i++)
+    {
+        pt.x = 100 + (i % 16) * 20 + 10;
+        pt.y = 100 + (i / 16) * 20 + 10;
+        win = WindowFromPoint(pt);
+        ok(win == child[i], "%d: WindowFromPoint returned %p, expected %p\n", i, win, child[i]);
+    }
+
+    /* move the first child on top of another one */
+    SetWindowPos(child[0], HWND_TOP, 20, 20, 20, 20, SWP_NOACTIVATE);
+    pt.x = pt.y = 130;
+    win = WindowFromPoint(pt);
+    ok(win == child[0], "WindowFromPoint returned %p, expected %p\n", win, child[0]);
+    pt.x = pt.y = 110;
+    win = WindowFromPoint(pt);
+    ok(win == hwnd, "WindowFromPoint returned %p, expected %p\n", win, hwnd);
+
+    ShowWindow(child[0], SW_HIDE);
+    pt.x = pt.y = 130;
+    win = WindowFromPoint(pt);
+    ok(win == child[17], "WindowFromPoint returned %p, expected %p\n", win, child[17]);
+
+    /* move a child to another parent and destroy it */
+    hwnd2 = CreateWindowExA(0, "MainWindowClass", NULL, WS_POPUP | WS_VISIBLE,
+            500, 100, 100, 100, 0, 0, NULL, NULL);
+    ok(hwnd2 != 0, "CreateWindowEx failed\n");
+    SetParent(child[1], hwnd2);
+    DestroyWindow(child[1]);
+    pt.x = 130;
+    pt.y = 110;
+    win = WindowFromPoint(pt);
+    ok(win == hwnd, "WindowFromPoint returned %p, expected %p\n", win, hwnd);
+    pt.x = 30;
+    pt.y = 10;
+    win = ChildWindowFromPointEx(hwnd, pt, CWP_SKIPINVISIBLE);
+    ok(win == hwnd, "ChildWindowFromPointEx returned %p, expected %p\n", win, hwnd);
+    pt.x = 50;
+    win = ChildWindowFromPointEx(hwnd, pt, CWP_SKIPINVISIBLE);
+    ok(win == child[2], "ChildWindowFromPointEx returned %p, expected %p\n", win, child[2]);
+
+    DestroyWindow(hwnd2);
+    DestroyWindow(hwnd);
+}
+
+static BOOL CALLBACK count_props_proc(HWND hwnd, LPSTR str, HANDLE data, ULONG_PTR lparam)
+{
+    (*(int *)lparam)++;
+    return TRUE;
+}
+
+static void test_window_properties(void)
+{
+    char name[16];
+    HANDLE data;
+    HWND hwnd;
+    int i, count;
+    BOOL ret;
+
+    hwnd = CreateWindowExA(0, "MainWindowClass", NULL, WS_POPUP, 0, 0, 100, 100, 0, 0, NULL, NULL);
+    ok(hwnd != 0, "CreateWindowEx failed\n");
+
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "test_prop_%d", i);
+        ret = SetPropA(hwnd, name, ULongToHandle(i + 1));
+        ok(ret, "%d: SetPropA failed\n", i);
+    }
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "test_prop_%d", i);
+        data = GetPropA(hwnd, name);
+        ok(data == ULongToHandle(i + 1), "%d: GetPropA returned %p\n", i, data);
+    }
+
+    for (i = 0; i < 100; i += 2)
+    {
+        sprintf(name, "test_prop_%d", i);
+        data = RemovePropA(hwnd, name);
+        ok(data == ULongToHandle(i + 1), "%d: RemovePropA returned %p\n", i, data);
+    }
+    count = 0;
+    EnumPropsExA(hwnd, count_props_proc, (LPARAM)&count);
+    ok(count == 50, "got %d properties\n", count);
+
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "test_prop_%d", i);
+        data = GetPropA(hwnd, name);
+        if (i % 2) ok(data == ULongToHandle(i + 1), "%d: GetPropA returned %p\n", i, data);
+        else ok(!data, "%d: GetPropA returned %p\n", i, data);
+    }
+
+    /* reuse the removed entries and overwrite the remaining ones */
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "test_prop_%d", i);
+        ret = SetPropA(hwnd, name, ULongToHandle(i + 1000));
+        ok(ret, "%d: SetPropA failed\n", i);
+    }
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "test_prop_%d", i);
+        data = GetPropA(hwnd, name);
+        ok(data == ULongToHandle(i + 1000), "%d: GetPropA returned %p\n", i, data);
+    }
+    count = 0;
+    EnumPropsExA(hwnd, count_props_proc, (LPARAM)&count);
+    ok(count == 100, "got %d properties\n", count);
+
+    DestroyWindow(hwnd);
+}
+
 static void simulate_click(int x, int y)
 {
     INPUT input[2];
@@ -12535,6 +12674,8 @@ START_TEST(win)
     /* Add the tests below this line */
     test_child_window_from_point();
     test_window_from_point(argv[0]);
+    test_window_from_point_many_children();
+    test_window_properties();
     test_thick_child_size(hwndMain);
     test_fullscreen();
     test_hwnd_message();
@@ -280,6 +280,13 @@ static void thread_detach(void)
         thread_info->queue_shared_memory = NULL;
     }
 
+    if (thread_info->queue_client_map)
+    {
+        CloseHandle( thread_info->queue_client_map );
+        thread_info->queue_client_map = NULL;
+        thread_info->queue_client_memory = NULL;
+    }
+
     if (thread_info->input_shared_map)
     {
         CloseHandle( thread_info->input_shared_map );
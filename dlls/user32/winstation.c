@@ -174,6 +174,44 @@ volatile struct queue_shared_memory *get_queue_shared_memory( void )
 }
 
 
+volatile struct queue_client_memory *get_queue_client_memory( void )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    SIZE_T size = sizeof(struct queue_client_memory);
+    HANDLE handle;
+    NTSTATUS status;
+    void *ptr = NULL;
+
+    if (thread_info->queue_client_memory) return thread_info->queue_client_memory;
+
+    /* the mapping is writable, so it's unnamed and only handed out to the owning thread */
+    SERVER_START_REQ( get_queue_client_mapping )
+    {
+        status = wine_server_call( req );
+        handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+    if (status)
+    {
+        ERR( "failed to get queue client mapping: %08x\n", status );
+        return NULL;
+    }
+
+    status = NtMapViewOfSection( handle, GetCurrentProcess(), &ptr, 0, 0, NULL,
+                                 &size, ViewUnmap, 0, PAGE_READWRITE );
+    if (status)
+    {
+        ERR( "failed to map view of queue client mapping: %08x\n", status );
+        CloseHandle( handle );
+        return NULL;
+    }
+
+    thread_info->queue_client_map = handle;
+    thread_info->queue_client_memory = ptr;
+    return thread_info->queue_client_memory;
+}
+
+
 static volatile struct input_shared_memory *get_thread_input_shared_memory( DWORD tid, HANDLE *handle,
                                                                             struct input_shared_memory **ptr )
 {
@@ -27,6 +27,7 @@
 #include "ntgdi_private.h"
 #include "dibdrv.h"
 
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
@@ -47,10 +48,16 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+#define FONT_CACHE_MIN_UNUSED  5                  /* unused fonts kept regardless of their size */
+#define GLYPH_CACHE_HIGH_WATER (16 * 1024 * 1024) /* glyph bytes above which unused fonts are dropped */
+#define GLYPH_CACHE_LOW_WATER  (12 * 1024 * 1024) /* glyph bytes the cache is trimmed down to */
+
 struct cached_font
 {
     struct list           entry;
+    struct wine_rb_entry  tree_entry;
     LONG                  ref;
+    LONG                  size;     /* total size of the cached glyphs */
     DWORD                 hash;
     LOGFONTW              lf;
     XFORM                 xform;
@@ -58,7 +65,12 @@ struct cached_font
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
-static struct list font_cache = LIST_INIT( font_cache );
+static int font_cache_compare( const void *key, const struct wine_rb_entry *entry );
+
+static struct list font_cache = LIST_INIT( font_cache );  /* most recently used first */
+static struct wine_rb_tree font_cache_tree = { font_cache_compare };
+static LONG glyph_cache_size;
+static LONG unused_fonts;  /* fonts in the cache that are not selected anywhere */
 
 static pthread_mutex_t font_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -543,7 +555,7 @@ static DWORD font_cache_hash( struct cached_font *font )
 
 static int font_cache_cmp( const struct cached_font *p1, const struct cached_font *p2 )
 {
-    int ret = p1->hash - p2->hash;
+    int ret = p1->hash == p2->hash ? 0 : (p1->hash > p2->hash ? 1 : -1);
     if (!ret) ret = p1->aa_flags - p2->aa_flags;
     if (!ret) ret = memcmp( &p1->xform, &p2->xform, sizeof(p1->xform) );
     if (!ret) ret = memcmp( &p1->lf, &p2->lf, FIELD_OFFSET( LOGFONTW, lfFaceName ));
@@ -551,10 +563,52 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static int font_cache_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    return font_cache_cmp( key, WINE_RB_ENTRY_VALUE( entry, const struct cached_font, tree_entry ));
+}
+
+/* font_cache_lock must be held and the font must be unused */
+static void free_cached_font( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                free( font->glyphs[i][j][k] );
+            free( font->glyphs[i][j] );
+        }
+    }
+    InterlockedExchangeAdd( &glyph_cache_size, -font->size );
+    list_remove( &font->entry );
+    wine_rb_remove( &font_cache_tree, &font->tree_entry );
+    free( font );
+}
+
+/* drop the least recently used fonts that are not selected anywhere */
+/* font_cache_lock must be held */
+static void trim_font_cache(void)
+{
+    struct cached_font *ptr, *next;
+    LONG max_size = glyph_cache_size > GLYPH_CACHE_HIGH_WATER ? GLYPH_CACHE_LOW_WATER : GLYPH_CACHE_HIGH_WATER;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( ptr, next, &font_cache, struct cached_font, entry )
+    {
+        if (unused_fonts <= FONT_CACHE_MIN_UNUSED && glyph_cache_size <= max_size) break;
+        if (ptr->ref) continue;
+        free_cached_font( ptr );
+        InterlockedDecrement( &unused_fonts );
+    }
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr;
+    struct wine_rb_entry *entry;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -570,37 +624,18 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.hash = font_cache_hash( &font );
 
     pthread_mutex_lock( &font_cache_lock );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
-    {
-        if (!font_cache_cmp( &font, ptr ))
-        {
-            InterlockedIncrement( &ptr->ref );
-            list_remove( &ptr->entry );
-            goto done;
-        }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
-    }
-
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    if ((entry = wine_rb_get( &font_cache_tree, &font )))
     {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    free( ptr->glyphs[i][j][k] );
-                free( ptr->glyphs[i][j] );
-            }
-        }
+        ptr = WINE_RB_ENTRY_VALUE( entry, struct cached_font, tree_entry );
+        if (InterlockedIncrement( &ptr->ref ) == 1) InterlockedDecrement( &unused_fonts );
         list_remove( &ptr->entry );
+        goto done;
     }
-    else if (!(ptr = malloc( sizeof(*ptr) )))
+
+    if (unused_fonts > FONT_CACHE_MIN_UNUSED || glyph_cache_size > GLYPH_CACHE_HIGH_WATER)
+        trim_font_cache();
+
+    if (!(ptr = malloc( sizeof(*ptr) )))
     {
         pthread_mutex_unlock( &font_cache_lock );
         return NULL;
@@ -608,7 +643,9 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
+    wine_rb_put( &font_cache_tree, ptr, &ptr->tree_entry );
 done:
     list_add_head( &font_cache, &ptr->entry );
     pthread_mutex_unlock( &font_cache_lock );
@@ -618,16 +655,17 @@ done:
 
 void release_cached_font( struct cached_font *font )
 {
-    if (font) InterlockedDecrement( &font->ref );
+    if (font && !InterlockedDecrement( &font->ref )) InterlockedIncrement( &unused_fonts );
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, UINT size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
     UINT page = index / GLYPH_CACHE_PAGE_SIZE;
     UINT entry = index % GLYPH_CACHE_PAGE_SIZE;
+    LONG prev_size;
 
     if (!font->glyphs[type][page])
     {
@@ -643,7 +681,19 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
             free( ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        InterlockedExchangeAdd( &font->size, size );
+        prev_size = InterlockedExchangeAdd( &glyph_cache_size, size );
+        /* the glyphs of the fonts in use are never dropped, so the cache can still grow past the limit */
+        if (prev_size <= GLYPH_CACHE_HIGH_WATER && prev_size + size > GLYPH_CACHE_HIGH_WATER)
+        {
+            pthread_mutex_lock( &font_cache_lock );
+            trim_font_cache();
+            pthread_mutex_unlock( &font_cache_lock );
+        }
+        ret = glyph;
+    }
     else free( glyph );
     return ret;
 }
@@ -804,15 +854,15 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
                            UINT flags, const WCHAR *str, UINT count, const INT *dx,
                            const struct clipped_rects *clipped_rects, RECT *bounds )
 {
-    UINT i;
-    struct cached_glyph *glyph;
+    UINT i, j, run, misses;
+    struct cached_glyph *glyph, *glyphs[64];
     dib_info glyph_dib;
     DWORD text_color;
     struct font_intensities intensity;
@@ -830,34 +880,51 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
     else
         get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), intensity.ranges );
 
-    for (i = 0; i < count; i++)
+    for (i = 0; i < count; i += run)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        /* resolve the whole run first so that missing glyphs are rasterized back to back */
+        run = min( count - i, ARRAY_SIZE(glyphs) );
+        for (j = 0, misses = 0; j < run; j++)
+            if (!(glyphs[j] = get_cached_glyph( font, str[i + j], flags ))) misses++;
+        if (misses)
+        {
+            for (j = 0; j < run; j++)
+            {
+                if (glyphs[j]) continue;
+                /* a repeated character may have been cached earlier in the run */
+                if (!(glyphs[j] = get_cached_glyph( font, str[i + j], flags )))
+                    glyphs[j] = cache_glyph_bitmap( dc, font, str[i + j], flags );
+            }
+        }
 
-        glyph_dib.width       = glyph->metrics.gmBlackBoxX;
-        glyph_dib.height      = glyph->metrics.gmBlackBoxY;
-        glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
-        glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
-        glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
-        glyph_dib.bits.ptr    = glyph->bits;
+        for (j = 0; j < run; j++)
+        {
+            if (!(glyph = glyphs[j])) continue;
 
-        draw_glyph( dib, x, y, &glyph->metrics, &glyph_dib, text_color, &intensity, clipped_rects, bounds );
+            glyph_dib.width       = glyph->metrics.gmBlackBoxX;
+            glyph_dib.height      = glyph->metrics.gmBlackBoxY;
+            glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
+            glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
+            glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
+            glyph_dib.bits.ptr    = glyph->bits;
 
-        if (dx)
-        {
-            if (flags & ETO_PDY)
+            draw_glyph( dib, x, y, &glyph->metrics, &glyph_dib, text_color, &intensity, clipped_rects, bounds );
+
+            if (dx)
             {
-                x += dx[ i * 2 ];
-                y += dx[ i * 2 + 1];
+                if (flags & ETO_PDY)
+                {
+                    x += dx[ (i + j) * 2 ];
+                    y += dx[ (i + j) * 2 + 1];
+                }
+                else
+                    x += dx[ i + j ];
             }
             else
-                x += dx[ i ];
-        }
-        else
-        {
-            x += glyph->metrics.gmCellIncX;
-            y += glyph->metrics.gmCellIncY;
+            {
+                x += glyph->metrics.gmCellIncX;
+                y += glyph->metrics.gmCellIncY;
+            }
         }
     }
 }
@@ -23,6 +23,11 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -4682,10 +4687,142 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef __SSE2__
+
+/* (x + 127) / 255 on each 16-bit lane, exact for x <= 255 * 255 */
+static inline __m128i div255_epu16( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ));
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 )), _mm_srli_epi16( x, 8 )), 8 );
+}
+
+static inline __m128i blend_argb_epu16( __m128i dst, __m128i src )
+{
+    __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+    return _mm_add_epi16( src, div255_epu16( _mm_mullo_epi16( dst, _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha ))));
+}
+
+static inline __m128i blend_constant_alpha_epu16( __m128i dst, __m128i src, __m128i alpha )
+{
+    return div255_epu16( _mm_add_epi16( _mm_mullo_epi16( src, alpha ),
+                                        _mm_mullo_epi16( dst, _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha ))));
+}
+
+/* pack channels back to pixels, or'ing overflow bits into the next channel like blend_argb does */
+static inline __m128i pack_argb_epu16( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i bytes = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ));
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+    return _mm_or_si128( bytes, _mm_slli_epi32( carry, 8 ));
+}
+
+#elif defined(__ARM_NEON)
+
+/* (x + 127) / 255 on each 16-bit lane, exact for x <= 255 * 255 */
+static inline uint16x8_t div255_u16( uint16x8_t x )
+{
+    x = vaddq_u16( x, vdupq_n_u16( 127 ));
+    return vshrq_n_u16( vaddq_u16( vaddq_u16( x, vdupq_n_u16( 1 )), vshrq_n_u16( x, 8 )), 8 );
+}
+
+#endif
+
+/* blend a row of premultiplied pixels, see blend_argb and blend_argb_alpha */
+static void blend_argb_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), const_alpha = _mm_set1_epi16( alpha );
+
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s_lo = _mm_unpacklo_epi8( s, zero ), s_hi = _mm_unpackhi_epi8( s, zero );
+
+        if (alpha != 255)
+        {
+            s_lo = div255_epu16( _mm_mullo_epi16( s_lo, const_alpha ));
+            s_hi = div255_epu16( _mm_mullo_epi16( s_hi, const_alpha ));
+        }
+        d = pack_argb_epu16( blend_argb_epu16( _mm_unpacklo_epi8( d, zero ), s_lo ),
+                             blend_argb_epu16( _mm_unpackhi_epi8( d, zero ), s_hi ));
+        _mm_storeu_si128( (__m128i *)(dst + x), d );
+    }
+#elif defined(__ARM_NEON)
+    const uint8x8_t const_alpha = vdup_n_u8( alpha ), max = vdup_n_u8( 255 );
+    int i;
+
+    for (; x + 8 <= len; x += 8)
+    {
+        uint8x8x4_t s = vld4_u8( (const uint8_t *)(src + x) );
+        uint8x8x4_t d = vld4_u8( (const uint8_t *)(dst + x) );
+        uint16x8_t val[4];
+        uint8x8_t inv;
+
+        if (alpha != 255)
+            for (i = 0; i < 4; i++) s.val[i] = vmovn_u16( div255_u16( vmull_u8( s.val[i], const_alpha )));
+        inv = vsub_u8( max, s.val[3] );
+        for (i = 0; i < 4; i++)
+            val[i] = vaddw_u8( div255_u16( vmull_u8( d.val[i], inv )), s.val[i] );
+        d.val[0] = vmovn_u16( val[0] );
+        for (i = 1; i < 4; i++) d.val[i] = vorr_u8( vmovn_u16( val[i] ), vshrn_n_u16( val[i - 1], 8 ));
+        vst4_u8( (uint8_t *)(dst + x), d );
+    }
+#endif
+    if (alpha == 255)
+        for (; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+    else
+        for (; x < len; x++) dst[x] = blend_argb_alpha( dst[x], src[x], alpha );
+}
+
+/* blend a row with a constant alpha, see blend_argb_constant_alpha and blend_argb_no_src_alpha */
+static void blend_argb_constant_alpha_row( DWORD *dst, const DWORD *src, int len, DWORD alpha, BOOL blend_src_alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), const_alpha = _mm_set1_epi16( alpha );
+    const __m128i src_mask = _mm_set1_epi32( blend_src_alpha ? 0 : 0xff000000 );
+
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), src_mask );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+
+        d = _mm_packus_epi16( blend_constant_alpha_epu16( _mm_unpacklo_epi8( d, zero ),
+                                                          _mm_unpacklo_epi8( s, zero ), const_alpha ),
+                              blend_constant_alpha_epu16( _mm_unpackhi_epi8( d, zero ),
+                                                          _mm_unpackhi_epi8( s, zero ), const_alpha ));
+        _mm_storeu_si128( (__m128i *)(dst + x), d );
+    }
+#elif defined(__ARM_NEON)
+    const uint8x8_t const_alpha = vdup_n_u8( alpha ), inv = vdup_n_u8( 255 - alpha );
+    int i;
+
+    for (; x + 8 <= len; x += 8)
+    {
+        uint8x8x4_t s = vld4_u8( (const uint8_t *)(src + x) );
+        uint8x8x4_t d = vld4_u8( (const uint8_t *)(dst + x) );
+
+        if (!blend_src_alpha) s.val[3] = vdup_n_u8( 255 );
+        for (i = 0; i < 4; i++)
+            d.val[i] = vmovn_u16( div255_u16( vmlal_u8( vmull_u8( s.val[i], const_alpha ), d.val[i], inv )));
+        vst4_u8( (uint8_t *)(dst + x), d );
+    }
+#endif
+    if (blend_src_alpha)
+        for (; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+    else
+        for (; x < len; x++) dst[x] = blend_argb_no_src_alpha( dst[x], src[x], alpha );
+}
+
 static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
                              const dib_info *src, const POINT *offset, BLENDFUNCTION blend)
 {
-    int i, x, y;
+    int i, y;
 
     for (i = 0; i < num; i++, rc++)
     {
@@ -4693,24 +4830,12 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
 
         if (blend.AlphaFormat & AC_SRC_ALPHA)
-        {
-            if (blend.SourceConstantAlpha == 255)
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
-            else
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-        }
-        else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_argb_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
         else
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_argb_constant_alpha_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha,
+                                               src->compression == BI_RGB );
     }
 }
 
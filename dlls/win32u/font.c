@@ -2337,11 +2337,13 @@ static void free_gdi_font( struct gdi_font *font )
         free_gdi_font( child );
     }
     for (i = 0; i < font->gm_size; i++) free( font->gm[i] );
+    for (i = 0; i < font->char_gm_size; i++) free( font->char_gm[i] );
     free( font->otm.otmpFamilyName );
     free( font->otm.otmpStyleName );
     free( font->otm.otmpFaceName );
     free( font->otm.otmpFullName );
     free( font->gm );
+    free( font->char_gm );
     free( font->kern_pairs );
     free( font->gsub_table );
     free( font );
@@ -2382,16 +2384,31 @@ struct glyph_metrics
 
 #define GM_BLOCK_SIZE 128
 
-/* TODO: GGO format support */
-static BOOL get_gdi_font_glyph_metrics( struct gdi_font *font, UINT index, GLYPHMETRICS *gm, ABC *abc )
+static struct glyph_metrics *get_glyph_metrics_block( struct glyph_metrics ***blocks, DWORD *size, UINT block )
+{
+    if (block >= *size)
+    {
+        struct glyph_metrics **ptr;
+
+        if (!(ptr = realloc( *blocks, (block + 1) * sizeof(*ptr) ))) return NULL;
+        memset( ptr + *size, 0, (block + 1 - *size) * sizeof(*ptr) );
+        *size = block + 1;
+        *blocks = ptr;
+    }
+    if (!(*blocks)[block]) (*blocks)[block] = calloc( sizeof(***blocks), GM_BLOCK_SIZE );
+    return (*blocks)[block];
+}
+
+static BOOL get_cached_glyph_metrics( struct glyph_metrics **blocks, DWORD size, UINT index,
+                                      GLYPHMETRICS *gm, ABC *abc )
 {
     UINT block = index / GM_BLOCK_SIZE;
     UINT entry = index % GM_BLOCK_SIZE;
 
-    if (block < font->gm_size && font->gm[block] && font->gm[block][entry].init)
+    if (block < size && blocks[block] && blocks[block][entry].init)
     {
-        *gm  = font->gm[block][entry].gm;
-        *abc = font->gm[block][entry].abc;
+        *gm  = blocks[block][entry].gm;
+        *abc = blocks[block][entry].abc;
 
         TRACE( "cached gm: %u, %u, %s, %d, %d abc: %d, %u, %d\n",
                gm->gmBlackBoxX, gm->gmBlackBoxY, wine_dbgstr_point( &gm->gmptGlyphOrigin ),
@@ -2402,29 +2419,40 @@ static BOOL get_gdi_font_glyph_metrics( struct gdi_font *font, UINT index, GLYPH
     return FALSE;
 }
 
+static void set_cached_glyph_metrics( struct glyph_metrics ***blocks, DWORD *size, UINT index,
+                                      const GLYPHMETRICS *gm, const ABC *abc )
+{
+    struct glyph_metrics *ptr;
+
+    if (!(ptr = get_glyph_metrics_block( blocks, size, index / GM_BLOCK_SIZE ))) return;
+    ptr += index % GM_BLOCK_SIZE;
+    ptr->gm   = *gm;
+    ptr->abc  = *abc;
+    ptr->init = TRUE;
+}
+
+/* TODO: GGO format support */
+static BOOL get_gdi_font_glyph_metrics( struct gdi_font *font, UINT index, GLYPHMETRICS *gm, ABC *abc )
+{
+    return get_cached_glyph_metrics( font->gm, font->gm_size, index, gm, abc );
+}
+
 static void set_gdi_font_glyph_metrics( struct gdi_font *font, UINT index,
                                         const GLYPHMETRICS *gm, const ABC *abc )
 {
-    UINT block = index / GM_BLOCK_SIZE;
-    UINT entry = index % GM_BLOCK_SIZE;
+    set_cached_glyph_metrics( &font->gm, &font->gm_size, index, gm, abc );
+}
 
-    if (block >= font->gm_size)
-    {
-        struct glyph_metrics **ptr;
+/* the character cache skips the glyph index lookup, including linked fonts and vertical substitution */
+static BOOL get_gdi_font_char_metrics( struct gdi_font *font, UINT ch, GLYPHMETRICS *gm, ABC *abc )
+{
+    return get_cached_glyph_metrics( font->char_gm, font->char_gm_size, ch, gm, abc );
+}
 
-        if (!(ptr = realloc( font->gm, (block + 1) * sizeof(*ptr) ))) return;
-        memset( ptr + font->gm_size, 0, (block + 1 - font->gm_size) * sizeof(*ptr) );
-        font->gm_size = block + 1;
-        font->gm = ptr;
-    }
-    if (!font->gm[block])
-    {
-        font->gm[block] = calloc( sizeof(**font->gm), GM_BLOCK_SIZE );
-        if (!font->gm[block]) return;
-    }
-    font->gm[block][entry].gm   = *gm;
-    font->gm[block][entry].abc  = *abc;
-    font->gm[block][entry].init = TRUE;
+static void set_gdi_font_char_metrics( struct gdi_font *font, UINT ch,
+                                       const GLYPHMETRICS *gm, const ABC *abc )
+{
+    set_cached_glyph_metrics( &font->char_gm, &font->char_gm_size, ch, gm, abc );
 }
 
 
@@ -3691,12 +3719,21 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
                                 GLYPHMETRICS *gm_ret, ABC *abc_ret, DWORD buflen, void *buf,
                                 const MAT2 *mat )
 {
+    struct gdi_font *char_font = NULL;
     GLYPHMETRICS gm;
     ABC abc;
     DWORD ret = 1;
     UINT index = glyph;
     BOOL tategaki = (*get_gdi_font_name( font ) == '@');
 
+    if (mat && !memcmp( mat, &identity, sizeof(*mat) )) mat = NULL;
+
+    if (format == GGO_METRICS && !mat)
+    {
+        if (get_gdi_font_char_metrics( font, glyph, &gm, &abc )) goto done;
+        char_font = font;
+    }
+
     if (format & GGO_GLYPH_INDEX)
     {
         /* Windows bitmap font, e.g. Small Fonts, uses ANSI character code
@@ -3718,10 +3755,8 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
         }
     }
 
-    if (mat && !memcmp( mat, &identity, sizeof(*mat) )) mat = NULL;
-
     if (format == GGO_METRICS && !mat && get_gdi_font_glyph_metrics( font, index, &gm, &abc ))
-        goto done;
+        goto cache_char;
 
     ret = font_funcs->get_glyph_outline( font, index, format, &gm, &abc, buflen, buf, mat, tategaki );
     if (ret == GDI_ERROR) return ret;
@@ -3729,6 +3764,8 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
     if ((format == GGO_METRICS || format == GGO_BITMAP || format ==  WINE_GGO_GRAY16_BITMAP) && !mat)
         set_gdi_font_glyph_metrics( font, index, &gm, &abc );
 
+cache_char:
+    if (char_font) set_gdi_font_char_metrics( char_font, glyph, &gm, &abc );
 done:
     if (gm_ret) *gm_ret = gm;
     if (abc_ret) *abc_ret = abc;
@@ -123,6 +123,7 @@
 #include "ntgdi_private.h"
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #ifdef HAVE_FREETYPE
 
@@ -1329,16 +1330,374 @@ static void unix_face_destroy( struct unix_face *This )
     free( This );
 }
 
+/* persistent cache of the faces parsed from font files, shared by all processes of the prefix */
+
+#define FACE_CACHE_MAGIC    0x43464e57  /* "WNFC" */
+#define FACE_CACHE_VERSION  2           /* bump when the record format or the face parsing changes */
+
+#define FACE_CACHE_VALID        0x01  /* the face could be parsed */
+#define FACE_CACHE_SCALABLE     0x02
+#define FACE_CACHE_ALLOW_BITMAP 0x04  /* the face was loaded with ADDFONT_ALLOW_BITMAP */
+
+struct face_cache_header
+{
+    UINT magic;
+    UINT version;
+    UINT lcid;
+    UINT count;
+    UINT ft_version;          /* FreeType version used to parse the faces */
+    char wine_version[28];    /* Wine version that wrote the cache */
+};
+
+struct face_cache_record
+{
+    UINT                    size;         /* size of the record including strings, aligned to 8 bytes */
+    UINT                    face_index;
+    UINT                    flags;
+    UINT                    num_faces;
+    ULONGLONG               dev;
+    ULONGLONG               ino;
+    ULONGLONG               file_size;
+    LONGLONG                mtime;
+    FONTSIGNATURE           fs;
+    DWORD                   ntm_flags;
+    DWORD                   font_version;
+    struct bitmap_font_size bitmap_size;
+    UINT                    path_len;     /* bytes including the terminator */
+    UINT                    name_len[4];  /* family, second, style and full name in WCHARs, 0 if missing */
+    /* char                 path[path_len]; */
+    /* WCHAR                names[]; */
+};
+
+struct face_cache_entry
+{
+    struct wine_rb_entry      entry;
+    struct face_cache_record *record;
+    BOOL                      used;       /* checked against the font file by this process */
+    BOOL                      allocated;  /* record isn't part of the mapped file */
+};
+
+static struct wine_rb_tree face_cache_tree;
+static char *face_cache_path;
+static BOOL face_cache_dirty;
+
+static const char *face_cache_record_path( const struct face_cache_record *record )
+{
+    return (const char *)(record + 1);
+}
+
+static int face_cache_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct face_cache_record *r1 = key;
+    const struct face_cache_record *r2 = WINE_RB_ENTRY_VALUE( entry, const struct face_cache_entry, entry )->record;
+    int ret = strcmp( face_cache_record_path( r1 ), face_cache_record_path( r2 ));
+
+    if (!ret && r1->face_index != r2->face_index) ret = r1->face_index > r2->face_index ? 1 : -1;
+    if (!ret) ret = (r1->flags & FACE_CACHE_ALLOW_BITMAP) - (r2->flags & FACE_CACHE_ALLOW_BITMAP);
+    return ret;
+}
+
+static BOOL face_cache_record_valid( const struct face_cache_record *record, size_t max_size )
+{
+    const WCHAR *name;
+    size_t size;
+    UINT i;
+
+    if (max_size < sizeof(*record) || record->size > max_size || record->size < sizeof(*record)) return FALSE;
+    if (record->size & 7) return FALSE;
+    if (record->path_len < 2 || record->path_len > record->size) return FALSE;
+    if (face_cache_record_path( record )[record->path_len - 1]) return FALSE;
+    size = sizeof(*record) + ((record->path_len + 1) & ~1);
+    name = (const WCHAR *)((const char *)record + size);
+    for (i = 0; i < ARRAY_SIZE(record->name_len); name += record->name_len[i++])
+    {
+        if (!record->name_len[i]) continue;
+        if (record->name_len[i] > (record->size - size) / sizeof(WCHAR)) return FALSE;
+        size += record->name_len[i] * sizeof(WCHAR);
+        if (name[record->name_len[i] - 1]) return FALSE;
+    }
+    return TRUE;
+}
+
+static struct face_cache_entry *face_cache_add_record( struct face_cache_record *record, BOOL allocated )
+{
+    struct face_cache_entry *entry;
+    struct wine_rb_entry *prev;
+
+    if (!(entry = malloc( sizeof(*entry) ))) return NULL;
+    entry->record = record;
+    entry->used = FALSE;
+    entry->allocated = allocated;
+    if ((prev = wine_rb_get( &face_cache_tree, record )))
+    {
+        struct face_cache_entry *old = WINE_RB_ENTRY_VALUE( prev, struct face_cache_entry, entry );
+        wine_rb_replace( &face_cache_tree, prev, &entry->entry );
+        if (old->allocated) free( old->record );
+        free( old );
+    }
+    else wine_rb_put( &face_cache_tree, record, &entry->entry );
+    return entry;
+}
+
+/* read the cache file, when merging only the faces missing from the tree are added */
+static void read_face_cache( BOOL merge )
+{
+    const struct face_cache_header *header;
+    struct face_cache_record *record, *copy;
+    struct stat st;
+    char *ptr, *end;
+    void *data;
+    UINT i;
+    int fd;
+
+    if ((fd = open( face_cache_path, O_RDONLY )) == -1) return;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return;
+    }
+    close( fd );
+
+    header = data;
+    if (header->magic != FACE_CACHE_MAGIC || header->version != FACE_CACHE_VERSION ||
+        header->lcid != system_lcid || header->ft_version != FT_SimpleVersion ||
+        strncmp( header->wine_version, PACKAGE_VERSION, sizeof(header->wine_version) ))
+    {
+        TRACE( "ignoring outdated cache %s\n", debugstr_a(face_cache_path) );
+        munmap( data, st.st_size );
+        return;
+    }
+
+    ptr = (char *)(header + 1);
+    end = (char *)data + st.st_size;
+    for (i = 0; i < header->count; i++, ptr += record->size)
+    {
+        record = (struct face_cache_record *)ptr;
+        if (!face_cache_record_valid( record, end - ptr )) break;
+        if (!merge) face_cache_add_record( record, FALSE );
+        else if (!wine_rb_get( &face_cache_tree, record ) && (copy = malloc( record->size )))
+        {
+            memcpy( copy, record, record->size );
+            if (!face_cache_add_record( copy, TRUE )) free( copy );
+        }
+    }
+    TRACE( "%s %u faces from %s\n", merge ? "merged" : "loaded", i, debugstr_a(face_cache_path) );
+
+    /* when loading, the mapping is kept for the lifetime of the process */
+    if (merge) munmap( data, st.st_size );
+}
+
+static void load_face_cache(void)
+{
+    static const char cache_name[] = "/fontcache.dat";
+    const char *dir;
+
+    wine_rb_init( &face_cache_tree, face_cache_compare );
+    /* the cache is kept in the prefix directory, out of reach of the applications */
+    if (!(dir = ntdll_get_config_dir())) return;
+    if (!(face_cache_path = malloc( strlen( dir ) + sizeof(cache_name) ))) return;
+    strcpy( face_cache_path, dir );
+    strcat( face_cache_path, cache_name );
+    read_face_cache( FALSE );
+}
+
+static struct unix_face *face_cache_get( const char *unix_name, UINT face_index, DWORD flags,
+                                         const struct stat *st, BOOL *found )
+{
+    struct face_cache_record *key;
+    struct face_cache_entry *entry;
+    struct wine_rb_entry *ptr;
+    struct unix_face *face;
+    const WCHAR *name;
+    WCHAR **names[4];
+    size_t len = strlen( unix_name ) + 1;
+    UINT i;
+
+    *found = FALSE;
+    if (!(key = malloc( sizeof(*key) + len ))) return NULL;
+    key->face_index = face_index;
+    key->flags = (flags & ADDFONT_ALLOW_BITMAP) ? FACE_CACHE_ALLOW_BITMAP : 0;
+    memcpy( key + 1, unix_name, len );
+    ptr = wine_rb_get( &face_cache_tree, key );
+    free( key );
+    if (!ptr) return NULL;
+
+    entry = WINE_RB_ENTRY_VALUE( ptr, struct face_cache_entry, entry );
+    if (entry->record->dev != st->st_dev || entry->record->ino != st->st_ino ||
+        entry->record->file_size != st->st_size || entry->record->mtime != st->st_mtime)
+        return NULL;
+
+    *found = entry->used = TRUE;
+    if (!(entry->record->flags & FACE_CACHE_VALID)) return NULL;
+    if (!(face = calloc( 1, sizeof(*face) ))) return NULL;
+
+    face->scalable = !!(entry->record->flags & FACE_CACHE_SCALABLE);
+    face->num_faces = entry->record->num_faces;
+    face->ntm_flags = entry->record->ntm_flags;
+    face->font_version = entry->record->font_version;
+    face->fs = entry->record->fs;
+    face->size = entry->record->bitmap_size;
+
+    names[0] = &face->family_name;
+    names[1] = &face->second_name;
+    names[2] = &face->style_name;
+    names[3] = &face->full_name;
+    name = (const WCHAR *)((const char *)(entry->record + 1) + ((entry->record->path_len + 1) & ~1));
+    for (i = 0; i < ARRAY_SIZE(names); name += entry->record->name_len[i++])
+    {
+        if (!entry->record->name_len[i]) continue;
+        if (!(*names[i] = malloc( entry->record->name_len[i] * sizeof(WCHAR) ))) break;
+        memcpy( *names[i], name, entry->record->name_len[i] * sizeof(WCHAR) );
+    }
+    if (i < ARRAY_SIZE(names) || !face->family_name)
+    {
+        *found = FALSE;
+        unix_face_destroy( face );
+        return NULL;
+    }
+    return face;
+}
+
+static void face_cache_put( const char *unix_name, UINT face_index, DWORD flags,
+                            const struct stat *st, const struct unix_face *face )
+{
+    const WCHAR *names[4] = { NULL };
+    struct face_cache_record *record;
+    struct face_cache_entry *entry;
+    UINT i, path_len = strlen( unix_name ) + 1, size;
+    WCHAR *ptr;
+
+    if (face)
+    {
+        names[0] = face->family_name;
+        names[1] = face->second_name;
+        names[2] = face->style_name;
+        names[3] = face->full_name;
+    }
+    size = sizeof(*record) + ((path_len + 1) & ~1);
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+        if (names[i]) size += (lstrlenW( names[i] ) + 1) * sizeof(WCHAR);
+    size = (size + 7) & ~7;
+
+    if (!(record = calloc( 1, size ))) return;
+    record->size = size;
+    record->face_index = face_index;
+    record->flags = (flags & ADDFONT_ALLOW_BITMAP) ? FACE_CACHE_ALLOW_BITMAP : 0;
+    record->dev = st->st_dev;
+    record->ino = st->st_ino;
+    record->file_size = st->st_size;
+    record->mtime = st->st_mtime;
+    record->path_len = path_len;
+    memcpy( record + 1, unix_name, path_len );
+    if (face)
+    {
+        record->flags |= FACE_CACHE_VALID;
+        if (face->scalable) record->flags |= FACE_CACHE_SCALABLE;
+        record->num_faces = face->num_faces;
+        record->fs = face->fs;
+        record->ntm_flags = face->ntm_flags;
+        record->font_version = face->font_version;
+        record->bitmap_size = face->size;
+    }
+    ptr = (WCHAR *)((char *)(record + 1) + ((path_len + 1) & ~1));
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        if (!names[i]) continue;
+        record->name_len[i] = lstrlenW( names[i] ) + 1;
+        memcpy( ptr, names[i], record->name_len[i] * sizeof(WCHAR) );
+        ptr += record->name_len[i];
+    }
+
+    if (!(entry = face_cache_add_record( record, TRUE )))
+    {
+        free( record );
+        return;
+    }
+    entry->used = TRUE;
+    face_cache_dirty = TRUE;
+}
+
+/* check that the font file of an entry didn't change since it was parsed */
+static BOOL face_cache_entry_valid( struct face_cache_entry *entry )
+{
+    struct stat st;
+
+    if (entry->used) return TRUE;
+    if (stat( face_cache_record_path( entry->record ), &st ) == -1) return FALSE;
+    return entry->record->dev == st.st_dev && entry->record->ino == st.st_ino &&
+           entry->record->file_size == st.st_size && entry->record->mtime == st.st_mtime;
+}
+
+/* write the cache back if this process added faces to it */
+/* the faces used by other processes are kept, unless their font file changed or was removed */
+static void save_face_cache(void)
+{
+    struct face_cache_header header;
+    struct face_cache_entry *entry;
+    char *tmp_path;
+    FILE *file;
+    int fd;
+
+    if (!face_cache_path || !face_cache_dirty) return;
+    face_cache_dirty = FALSE;
+
+    /* pick up the faces added by other processes since the cache was loaded */
+    read_face_cache( TRUE );
+
+    if (!(tmp_path = malloc( strlen( face_cache_path ) + 16 ))) return;
+    sprintf( tmp_path, "%s.%u", face_cache_path, (unsigned int)getpid() );
+    if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) == -1 || !(file = fdopen( fd, "wb" )))
+    {
+        if (fd != -1) close( fd );
+        free( tmp_path );
+        return;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    header.magic = FACE_CACHE_MAGIC;
+    header.version = FACE_CACHE_VERSION;
+    header.lcid = system_lcid;
+    header.ft_version = FT_SimpleVersion;
+    snprintf( header.wine_version, sizeof(header.wine_version), "%s", PACKAGE_VERSION );
+
+    /* the count is only known once the records are written */
+    fwrite( &header, sizeof(header), 1, file );
+    WINE_RB_FOR_EACH_ENTRY( entry, &face_cache_tree, struct face_cache_entry, entry )
+    {
+        if (!face_cache_entry_valid( entry )) continue;
+        fwrite( entry->record, entry->record->size, 1, file );
+        header.count++;
+    }
+    rewind( file );
+    fwrite( &header, sizeof(header), 1, file );
+
+    if (fclose( file ) || rename( tmp_path, face_cache_path ) == -1) unlink( tmp_path );
+    else TRACE( "saved %u faces to %s\n", header.count, debugstr_a(face_cache_path) );
+    free( tmp_path );
+}
+
 static int add_unix_face( const char *unix_name, const WCHAR *file, void *data_ptr, SIZE_T data_size,
                           DWORD face_index, DWORD flags, DWORD *num_faces )
 {
     struct unix_face *unix_face;
+    struct stat st;
+    BOOL cached = FALSE;
     int ret;
 
     if (num_faces) *num_faces = 0;
 
-    if (!(unix_face = unix_face_create( unix_name, data_ptr, data_size, face_index, flags )))
-        return 0;
+    if (unix_name && !data_ptr && !stat( unix_name, &st ))
+    {
+        if (!(unix_face = face_cache_get( unix_name, face_index, flags, &st, &cached )) && !cached)
+        {
+            unix_face = unix_face_create( unix_name, data_ptr, data_size, face_index, flags );
+            face_cache_put( unix_name, face_index, flags, &st, unix_face );
+        }
+    }
+    else unix_face = unix_face_create( unix_name, data_ptr, data_size, face_index, flags );
+
+    if (!unix_face) return 0;
 
     if (unix_face->family_name[0] == '.') /* Ignore fonts with names beginning with a dot */
     {
@@ -1456,6 +1815,8 @@ static INT freetype_add_font( const WCHAR *file, DWORD flags )
         ret = AddFontToList( file, unixname, NULL, 0, flags );
         free( unixname );
     }
+    /* fonts added after initialization need to be saved too */
+    if (flags & ADDFONT_ADD_RESOURCE) save_face_cache();
     return ret;
 }
 
@@ -1953,6 +2314,7 @@ static void freetype_load_fonts(void)
 #elif defined(__ANDROID__)
     ReadFontDir("/system/fonts", TRUE);
 #endif
+    save_face_cache();
 }
 
 /* Some fonts have large usWinDescent values, as a result of storing signed short
@@ -4317,6 +4679,7 @@ const struct font_backend_funcs *init_freetype_lib(void)
     init_fontconfig();
 #endif
     NtQueryDefaultLocale( FALSE, &system_lcid );
+    load_face_cache();
     return &font_funcs;
 }
 
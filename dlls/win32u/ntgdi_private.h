@@ -242,6 +242,8 @@ struct gdi_font
     DWORD                  refcount;
     DWORD                  gm_size;
     struct glyph_metrics **gm;
+    DWORD                  char_gm_size;
+    struct glyph_metrics **char_gm;  /* metrics indexed by character code */
     OUTLINETEXTMETRICW     otm;
     KERNINGPAIR           *kern_pairs;
     int                    kern_count;
@@ -127,6 +127,12 @@ static inline BOOL overlapping( const RECT *r1, const RECT *r2 )
             r1->bottom > r2->top && r1->top < r2->bottom);
 }
 
+static inline BOOL rect_contains( const RECT *outer, const RECT *inner )
+{
+    return (outer->left <= inner->left && outer->top <= inner->top &&
+            outer->right >= inner->right && outer->bottom >= inner->bottom);
+}
+
 static BOOL grow_region( WINEREGION *rgn, int size )
 {
     RECT *new_rects;
@@ -1579,7 +1585,7 @@ static BOOL REGION_RegionOp(
 	    BOOL (*nonOverlap1Func)(WINEREGION*, RECT*, RECT*, INT, INT), /* Function to call for non-overlapping bands in region 1 */
 	    BOOL (*nonOverlap2Func)(WINEREGION*, RECT*, RECT*, INT, INT)  /* Function to call for non-overlapping bands in region 2 */
 ) {
-    WINEREGION newReg;
+    WINEREGION tmpReg, *newReg = destReg;
     RECT *r1;                         /* Pointer into first region */
     RECT *r2;                         /* Pointer into 2d region */
     RECT *r1End;                      /* End of 1st region */
@@ -1614,7 +1620,12 @@ static BOOL REGION_RegionOp(
      * have to worry about using too much memory. I hope to be able to
      * nuke the Xrealloc() at the end of this function eventually.
      */
-    if (!init_region( &newReg, max(reg1->numRects,reg2->numRects) * 2 )) return FALSE;
+    if (destReg == reg1 || destReg == reg2)
+    {
+        newReg = &tmpReg;
+        if (!init_region( newReg, max(reg1->numRects,reg2->numRects) * 2 )) return FALSE;
+    }
+    else destReg->numRects = 0;  /* the destination rectangles can be reused directly */
 
     /*
      * Initialize ybot and ytop.
@@ -1647,7 +1658,7 @@ static BOOL REGION_RegionOp(
 
     do
     {
-	curBand = newReg.numRects;
+	curBand = newReg->numRects;
 
 	/*
 	 * This algorithm proceeds one source-band (as opposed to a
@@ -1683,7 +1694,7 @@ static BOOL REGION_RegionOp(
 
             if ((top != bot) && (nonOverlap1Func != NULL))
 	    {
-		if (!nonOverlap1Func(&newReg, r1, r1BandEnd, top, bot)) return FALSE;
+		if (!nonOverlap1Func(newReg, r1, r1BandEnd, top, bot)) return FALSE;
 	    }
 
 	    ytop = r2->top;
@@ -1695,7 +1706,7 @@ static BOOL REGION_RegionOp(
 
             if ((top != bot) && (nonOverlap2Func != NULL))
 	    {
-		if (!nonOverlap2Func(&newReg, r2, r2BandEnd, top, bot)) return FALSE;
+		if (!nonOverlap2Func(newReg, r2, r2BandEnd, top, bot)) return FALSE;
 	    }
 
 	    ytop = r1->top;
@@ -1711,9 +1722,9 @@ static BOOL REGION_RegionOp(
 	 * this test in miCoalesce, but some machines incur a not
 	 * inconsiderable cost for function calls, so...
 	 */
-	if (newReg.numRects != curBand)
+	if (newReg->numRects != curBand)
 	{
-	    prevBand = REGION_Coalesce (&newReg, prevBand, curBand);
+	    prevBand = REGION_Coalesce (newReg, prevBand, curBand);
 	}
 
 	/*
@@ -1721,15 +1732,15 @@ static BOOL REGION_RegionOp(
 	 * intersect if ybot > ytop
 	 */
 	ybot = min(r1->bottom, r2->bottom);
-	curBand = newReg.numRects;
+	curBand = newReg->numRects;
 	if (ybot > ytop)
 	{
-	    if (!overlapFunc(&newReg, r1, r1BandEnd, r2, r2BandEnd, ytop, ybot)) return FALSE;
+	    if (!overlapFunc(newReg, r1, r1BandEnd, r2, r2BandEnd, ytop, ybot)) return FALSE;
 	}
 
-	if (newReg.numRects != curBand)
+	if (newReg->numRects != curBand)
 	{
-	    prevBand = REGION_Coalesce (&newReg, prevBand, curBand);
+	    prevBand = REGION_Coalesce (newReg, prevBand, curBand);
 	}
 
 	/*
@@ -1749,7 +1760,7 @@ static BOOL REGION_RegionOp(
     /*
      * Deal with whichever region still has rectangles left.
      */
-    curBand = newReg.numRects;
+    curBand = newReg->numRects;
     if (r1 != r1End)
     {
         if (nonOverlap1Func != NULL)
@@ -1761,7 +1772,7 @@ static BOOL REGION_RegionOp(
 		{
 		    r1BandEnd++;
 		}
-		if (!nonOverlap1Func(&newReg, r1, r1BandEnd, max(r1->top,ybot), r1->bottom))
+		if (!nonOverlap1Func(newReg, r1, r1BandEnd, max(r1->top,ybot), r1->bottom))
                     return FALSE;
 		r1 = r1BandEnd;
 	    } while (r1 != r1End);
@@ -1776,19 +1787,19 @@ static BOOL REGION_RegionOp(
 	    {
 		 r2BandEnd++;
 	    }
-	    if (!nonOverlap2Func(&newReg, r2, r2BandEnd, max(r2->top,ybot), r2->bottom))
+	    if (!nonOverlap2Func(newReg, r2, r2BandEnd, max(r2->top,ybot), r2->bottom))
                 return FALSE;
 	    r2 = r2BandEnd;
 	} while (r2 != r2End);
     }
 
-    if (newReg.numRects != curBand)
+    if (newReg->numRects != curBand)
     {
-	REGION_Coalesce (&newReg, prevBand, curBand);
+	REGION_Coalesce (newReg, prevBand, curBand);
     }
 
-    REGION_compact( &newReg );
-    move_rects( destReg, &newReg );
+    REGION_compact( newReg );
+    if (newReg != destReg) move_rects( destReg, newReg );
     return TRUE;
 }
 
@@ -1864,6 +1875,18 @@ static BOOL REGION_IntersectRegion(WINEREGION *newReg, WINEREGION *reg1,
     if ( (!(reg1->numRects)) || (!(reg2->numRects))  ||
 	(!overlapping(&reg1->extents, &reg2->extents)))
 	newReg->numRects = 0;
+    else if (reg1->numRects == 1 && reg2->numRects == 1)
+    {
+        intersect_rect( &newReg->extents, &reg1->extents, &reg2->extents );
+        newReg->rects[0] = newReg->extents;
+        newReg->numRects = 1;
+        return TRUE;
+    }
+    /* a single rectangle containing the other region leaves it unchanged */
+    else if (reg1->numRects == 1 && rect_contains( &reg1->extents, &reg2->extents ))
+        return REGION_CopyRegion( newReg, reg2 );
+    else if (reg2->numRects == 1 && rect_contains( &reg2->extents, &reg1->extents ))
+        return REGION_CopyRegion( newReg, reg1 );
     else
 	if (!REGION_RegionOp (newReg, reg1, reg2, REGION_IntersectO, NULL, NULL)) return FALSE;
 
@@ -1998,11 +2021,7 @@ static BOOL REGION_UnionRegion(WINEREGION *newReg, WINEREGION *reg1, WINEREGION
     /*
      * Region 1 completely subsumes region 2
      */
-    if ((reg1->numRects == 1) &&
-	(reg1->extents.left <= reg2->extents.left) &&
-	(reg1->extents.top <= reg2->extents.top) &&
-	(reg1->extents.right >= reg2->extents.right) &&
-	(reg1->extents.bottom >= reg2->extents.bottom))
+    if (reg1->numRects == 1 && rect_contains( &reg1->extents, &reg2->extents ))
     {
 	if (newReg != reg1)
 	    ret = REGION_CopyRegion(newReg, reg1);
@@ -2012,11 +2031,7 @@ static BOOL REGION_UnionRegion(WINEREGION *newReg, WINEREGION *reg1, WINEREGION
     /*
      * Region 2 completely subsumes region 1
      */
-    if ((reg2->numRects == 1) &&
-	(reg2->extents.left <= reg1->extents.left) &&
-	(reg2->extents.top <= reg1->extents.top) &&
-	(reg2->extents.right >= reg1->extents.right) &&
-	(reg2->extents.bottom >= reg1->extents.bottom))
+    if (reg2->numRects == 1 && rect_contains( &reg2->extents, &reg1->extents ))
     {
 	if (newReg != reg2)
 	    ret = REGION_CopyRegion(newReg, reg2);
@@ -2188,6 +2203,13 @@ static BOOL REGION_SubtractRegion(WINEREGION *regD, WINEREGION *regM, WINEREGION
 	(!overlapping(&regM->extents, &regS->extents)) )
 	return REGION_CopyRegion(regD, regM);
 
+    /* a single rectangle containing the minuend leaves nothing */
+    if (regS->numRects == 1 && rect_contains( &regS->extents, &regM->extents ))
+    {
+        empty_region( regD );
+        return TRUE;
+    }
+
     if (!REGION_RegionOp (regD, regM, regS, REGION_SubtractO, REGION_SubtractNonO1, NULL))
         return FALSE;
 
@@ -104,6 +104,8 @@ struct user_thread_info
     struct desktop_shared_memory *desktop_shared_memory;  /* Ptr to server's desktop shared memory */
     HANDLE                        queue_shared_map;       /* HANDLE to server's thread queue shared memory */
     struct queue_shared_memory   *queue_shared_memory;     /* Ptr to server's thread queue shared memory */
+    HANDLE                        queue_client_map;       /* HANDLE to thread queue client writable memory */
+    struct queue_client_memory   *queue_client_memory;    /* Ptr to thread queue client writable memory */
     HANDLE                        input_shared_map;       /* HANDLE to server's thread input shared memory */
     struct input_shared_memory   *input_shared_memory;    /* Ptr to server's thread input shared memory */
     HANDLE                        foreground_shared_map;    /* HANDLE to server's thread input shared memory */
@@ -808,6 +808,7 @@ typedef struct _WIN32_MEMORY_RANGE_ENTRY
 #define MEM_RESET                0x00080000
 #define MEM_TOP_DOWN             0x00100000
 #define MEM_PHYSICAL             0x00400000
+#define MEM_DIFFERENT_IMAGE_BASE_OK 0x00800000
 #define MEM_RESET_UNDO           0x10000000
 #define MEM_LARGE_PAGES          0x20000000
 
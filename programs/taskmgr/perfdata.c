@@ -35,6 +35,7 @@ static PPERFDATA                       pPerfDataOld = NULL;    /* Older perf dat
 static PPERFDATA                       pPerfData = NULL;    /* Most recent copy of perf data */
 static ULONG                           ProcessCountOld = 0;
 static ULONG                           ProcessCount = 0;
+static ULONG                           ProcessInfoSize = 0x10000;
 static double                          dbIdleTime;
 static double                          dbKernelTime;
 static double                          dbSystemTime;
@@ -133,22 +134,23 @@ void PerfDataRefresh(void)
     } while (status == 0xC0000004 /*STATUS_INFO_LENGTH_MISMATCH*/);
 
     /* Get process information
-     * We don't know how much data there is so just keep
-     * increasing the buffer size until the call succeeds
+     * Start with the size that worked last time and grow to the
+     * size reported by the call, plus some room for new processes
      */
-    BufferSize = 0;
+    BufferSize = ProcessInfoSize;
     do
     {
-        BufferSize += 0x10000;
         pBuffer = HeapAlloc(GetProcessHeap(), 0, BufferSize);
 
         status = NtQuerySystemInformation(SystemProcessInformation, pBuffer, BufferSize, &ulSize);
 
         if (status == 0xC0000004 /*STATUS_INFO_LENGTH_MISMATCH*/) {
             HeapFree(GetProcessHeap(), 0, pBuffer);
+            BufferSize = max(BufferSize, ulSize) + 0x10000;
         }
 
     } while (status == 0xC0000004 /*STATUS_INFO_LENGTH_MISMATCH*/);
+    ProcessInfoSize = BufferSize;
 
     EnterCriticalSection(&PerfDataCriticalSection);
 
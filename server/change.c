@@ -357,8 +357,7 @@ static struct security_descriptor *dir_get_sd( struct object *obj )
 
     dir->mode = st.st_mode;
     dir->uid = st.st_uid;
-    free( obj->sd );
-    obj->sd = sd;
+    set_object_sd( obj, sd );
     return sd;
 }
 
@@ -470,7 +469,7 @@ static enum server_fd_type dir_get_fd_type( struct fd *fd )
 
 #ifdef HAVE_SYS_INOTIFY_H
 
-#define HASH_SIZE 31
+#define INODE_HASH_MIN_SIZE 31
 
 struct inode {
     struct list ch_entry;    /* entry in the children list */
@@ -485,14 +484,18 @@ struct inode {
     char *name;              /* basename name of the inode */
 };
 
-static struct list inode_hash[ HASH_SIZE ];
-static struct list wd_hash[ HASH_SIZE ];
+/* both hashes have the same size and grow with the number of inodes,
+ * recursive watches on large trees can track hundreds of thousands of them */
+static struct list *inode_hash;
+static struct list *wd_hash;
+static unsigned int inode_hash_size;
+static unsigned int inode_count;
 
 static int inotify_add_dir( char *path, unsigned int filter );
 
 static struct inode *inode_from_wd( int wd )
 {
-    struct list *bucket = &wd_hash[ wd % HASH_SIZE ];
+    struct list *bucket = &wd_hash[ (unsigned int)wd % inode_hash_size ];
     struct inode *inode;
 
     LIST_FOR_EACH_ENTRY( inode, bucket, struct inode, wd_entry )
@@ -504,7 +507,46 @@ static struct inode *inode_from_wd( int wd )
 
 static inline struct list *get_hash_list( dev_t dev, ino_t ino )
 {
-    return &inode_hash[ (ino ^ dev) % HASH_SIZE ];
+    return &inode_hash[ (ino ^ dev) % inode_hash_size ];
+}
+
+static void grow_inode_hash(void)
+{
+    unsigned int i, size = inode_hash_size * 2 + 1;
+    struct list *new_inode_hash, *new_wd_hash;
+    struct inode *inode, *next;
+
+    if (!(new_inode_hash = malloc( size * sizeof(*new_inode_hash) ))) return;
+    if (!(new_wd_hash = malloc( size * sizeof(*new_wd_hash) )))
+    {
+        free( new_inode_hash );
+        return;
+    }
+    for (i = 0; i < size; i++)
+    {
+        list_init( &new_inode_hash[i] );
+        list_init( &new_wd_hash[i] );
+    }
+
+    for (i = 0; i < inode_hash_size; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( inode, next, &inode_hash[i], struct inode, ino_entry )
+        {
+            list_remove( &inode->ino_entry );
+            list_add_tail( &new_inode_hash[(inode->ino ^ inode->dev) % size], &inode->ino_entry );
+        }
+        LIST_FOR_EACH_ENTRY_SAFE( inode, next, &wd_hash[i], struct inode, wd_entry )
+        {
+            list_remove( &inode->wd_entry );
+            list_add_tail( &new_wd_hash[(unsigned int)inode->wd % size], &inode->wd_entry );
+        }
+    }
+
+    free( inode_hash );
+    free( wd_hash );
+    inode_hash = new_inode_hash;
+    wd_hash = new_wd_hash;
+    inode_hash_size = size;
 }
 
 static struct inode *find_inode( dev_t dev, ino_t ino )
@@ -523,9 +565,12 @@ static struct inode *create_inode( dev_t dev, ino_t ino )
 {
     struct inode *inode;
 
+    if (inode_count >= inode_hash_size * 2) grow_inode_hash();
+
     inode = malloc( sizeof *inode );
     if (inode)
     {
+        inode_count++;
         list_init( &inode->children );
         list_init( &inode->dirs );
         inode->ino = ino;
@@ -553,7 +598,7 @@ static void inode_set_wd( struct inode *inode, int wd )
     if (inode->wd != -1)
         list_remove( &inode->wd_entry );
     inode->wd = wd;
-    list_add_tail( &wd_hash[ wd % HASH_SIZE ], &inode->wd_entry );
+    list_add_tail( &wd_hash[ (unsigned int)wd % inode_hash_size ], &inode->wd_entry );
 }
 
 static void inode_set_name( struct inode *inode, const char *name )
@@ -604,6 +649,7 @@ static void free_inode( struct inode *inode )
         list_remove( &inode->wd_entry );
     }
     list_remove( &inode->ino_entry );
+    inode_count--;
 
     free( inode->name );
     free( inode );
@@ -658,6 +704,20 @@ static int inotify_get_poll_events( struct fd *fd )
     return POLLIN;
 }
 
+/* a file being written generates a stream of identical modifications,
+ * only keep one of them as long as the client hasn't picked it up yet */
+static int is_repeated_change( struct dir *dir, unsigned int action, const char *relpath )
+{
+    struct change_record *record;
+    struct list *tail;
+
+    if (action != FILE_ACTION_MODIFIED) return 0;
+    if (!(tail = list_tail( &dir->change_records ))) return 0;
+    record = LIST_ENTRY( tail, struct change_record, entry );
+    return record->event.action == action && record->event.len == strlen( relpath ) &&
+           !memcmp( record->event.name, relpath, record->event.len );
+}
+
 static void inotify_do_change_notify( struct dir *dir, unsigned int action,
                                       unsigned int cookie, const char *relpath )
 {
@@ -665,7 +725,7 @@ static void inotify_do_change_notify( struct dir *dir, unsigned int action,
 
     assert( dir->obj.ops == &dir_ops );
 
-    if (dir->want_data)
+    if (dir->want_data && !is_repeated_change( dir, action, relpath ))
     {
         size_t len = strlen(relpath);
         record = malloc( offsetof(struct change_record, event.name[len]) );
@@ -948,16 +1008,27 @@ static int init_inotify( void )
     if (inotify_fd)
         return 1;
 
+    if (!inode_hash)
+    {
+        if (!(inode_hash = malloc( INODE_HASH_MIN_SIZE * sizeof(*inode_hash) ))) return 0;
+        if (!(wd_hash = malloc( INODE_HASH_MIN_SIZE * sizeof(*wd_hash) )))
+        {
+            free( inode_hash );
+            inode_hash = NULL;
+            return 0;
+        }
+        inode_hash_size = INODE_HASH_MIN_SIZE;
+        for (i = 0; i < inode_hash_size; i++)
+        {
+            list_init( &inode_hash[i] );
+            list_init( &wd_hash[i] );
+        }
+    }
+
     inotify_fd = create_inotify_fd();
     if (!inotify_fd)
         return 0;
 
-    for (i=0; i<HASH_SIZE; i++)
-    {
-        list_init( &inode_hash[i] );
-        list_init( &wd_hash[i] );
-    }
-
     return 1;
 }
 
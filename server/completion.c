@@ -150,7 +150,7 @@ static void completion_wait_destroy( struct object *obj)
 
     LIST_FOR_EACH_ENTRY_SAFE( tmp, next, &wait->queue, struct comp_msg, queue_entry )
     {
-        free( tmp );
+        cache_free( tmp, sizeof(*tmp) );
     }
 }
 
@@ -248,7 +248,7 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct comp_msg *msg = cache_alloc( sizeof( *msg ) );
 
     if (!msg)
         return;
@@ -310,8 +310,10 @@ DECL_HANDLER(remove_completion)
 {
     struct completion* completion;
     struct completion_wait *wait;
+    struct completion_msg *msgs = NULL;
     struct list *entry;
     struct comp_msg *msg;
+    data_size_t i, count = 0;
 
     if (req->waited && (wait = (struct completion_wait *)current->locked_completion))
         current->locked_completion = NULL;
@@ -336,6 +338,15 @@ DECL_HANDLER(remove_completion)
         set_error( STATUS_PENDING );
     else
     {
+        /* hand out as many further messages as the client has room for, so that
+         * draining a busy port doesn't take one round trip per message */
+        if (wait->depth > 1) count = min( get_reply_max_size() / sizeof(*msgs), wait->depth - 1 );
+        if (count && !(msgs = set_reply_data_size( count * sizeof(*msgs) )))
+        {
+            release_object( wait );
+            return;
+        }
+
         list_remove( entry );
         wait->depth--;
         msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
@@ -343,7 +354,21 @@ DECL_HANDLER(remove_completion)
         reply->cvalue = msg->cvalue;
         reply->status = msg->status;
         reply->information = msg->information;
-        free( msg );
+        cache_free( msg, sizeof(*msg) );
+
+        for (i = 0; i < count; i++)
+        {
+            entry = list_head( &wait->queue );
+            list_remove( entry );
+            wait->depth--;
+            msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+            msgs[i].ckey = msg->ckey;
+            msgs[i].cvalue = msg->cvalue;
+            msgs[i].information = msg->information;
+            msgs[i].status = msg->status;
+            msgs[i].__pad = 0;
+            cache_free( msg, sizeof(*msg) );
+        }
     }
 
     release_object( wait );
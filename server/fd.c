@@ -377,14 +377,27 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in expired timeouts list */
     abstime_t             when;       /* timeout expiry */
+    unsigned int          index;      /* index in the timeout heap, or TIMEOUT_EXPIRED */
+    unsigned int          serial;     /* insertion order, for timeouts expiring at the same time */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+#define TIMEOUT_EXPIRED (~0u)
+
+/* binary min-heap of timeouts, ordered by expiry time */
+struct timeout_heap
+{
+    struct timeout_user **users;      /* heap array */
+    unsigned int          count;      /* number of timeouts in the heap */
+    unsigned int          size;       /* allocated size of the array */
+};
+
+static struct timeout_heap abs_timeouts;  /* absolute timeouts */
+static struct timeout_heap rel_timeouts;  /* relative timeouts */
+static unsigned int timeout_serial;
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -461,44 +474,108 @@ void set_current_time(void)
     if (user_shared_data) set_user_shared_data_time();
 }
 
+static inline struct timeout_heap *get_timeout_heap( const struct timeout_user *user )
+{
+    return user->when > 0 ? &abs_timeouts : &rel_timeouts;
+}
+
+/* check if a timeout expires before another one of the same heap */
+static inline int timeout_before( const struct timeout_user *a, const struct timeout_user *b )
+{
+    /* relative timeouts are stored as negative values */
+    if (a->when != b->when) return a->when > 0 ? a->when < b->when : a->when > b->when;
+    return (int)(a->serial - b->serial) > 0;  /* the most recently added one goes first */
+}
+
+static inline void set_timeout_heap_entry( struct timeout_heap *heap, unsigned int index,
+                                           struct timeout_user *user )
+{
+    heap->users[index] = user;
+    user->index = index;
+}
+
+static void timeout_heap_sift_up( struct timeout_heap *heap, unsigned int index )
+{
+    struct timeout_user *user = heap->users[index];
+
+    while (index)
+    {
+        unsigned int parent = (index - 1) / 2;
+        if (!timeout_before( user, heap->users[parent] )) break;
+        set_timeout_heap_entry( heap, index, heap->users[parent] );
+        index = parent;
+    }
+    set_timeout_heap_entry( heap, index, user );
+}
+
+static void timeout_heap_sift_down( struct timeout_heap *heap, unsigned int index )
+{
+    struct timeout_user *user = heap->users[index];
+    unsigned int child;
+
+    while ((child = 2 * index + 1) < heap->count)
+    {
+        if (child + 1 < heap->count && timeout_before( heap->users[child + 1], heap->users[child] )) child++;
+        if (!timeout_before( heap->users[child], user )) break;
+        set_timeout_heap_entry( heap, index, heap->users[child] );
+        index = child;
+    }
+    set_timeout_heap_entry( heap, index, user );
+}
+
+/* remove a timeout from its heap */
+static void timeout_heap_remove( struct timeout_heap *heap, struct timeout_user *user )
+{
+    unsigned int index = user->index;
+    struct timeout_user *last = heap->users[--heap->count];
+
+    user->index = TIMEOUT_EXPIRED;
+    if (last == user) return;
+    set_timeout_heap_entry( heap, index, last );
+    if (index && timeout_before( last, heap->users[(index - 1) / 2] )) timeout_heap_sift_up( heap, index );
+    else timeout_heap_sift_down( heap, index );
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
+    struct timeout_heap *heap;
 
-    if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
+    if (!(user = cache_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
+    user->serial   = timeout_serial++;
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
+    /* Now insert it in the heap */
 
-    if (user->when > 0)
+    heap = get_timeout_heap( user );
+    if (heap->count == heap->size)
     {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
-    {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
+        unsigned int new_size = max( 64, heap->size * 2 );
+        struct timeout_user **new_users;
+
+        if (!(new_users = realloc( heap->users, new_size * sizeof(*new_users) )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
+            set_error( STATUS_NO_MEMORY );
+            cache_free( user, sizeof(*user) );
+            return NULL;
         }
+        heap->users = new_users;
+        heap->size = new_size;
     }
-    list_add_before( ptr, &user->entry );
+    set_timeout_heap_entry( heap, heap->count++, user );
+    timeout_heap_sift_up( heap, user->index );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
-    free( user );
+    if (user->index == TIMEOUT_EXPIRED) list_remove( &user->entry );
+    else timeout_heap_remove( get_timeout_heap( user ), user );
+    cache_free( user, sizeof(*user) );
 }
 
 /* return a text description of a timeout for debugging purposes */
@@ -932,59 +1009,46 @@ static int get_next_timeout(void)
 {
     int ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeouts.count || rel_timeouts.count)
     {
         struct list expired_list, *ptr;
+        struct timeout_user *timeout;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heaps */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while (abs_timeouts.count && (timeout = abs_timeouts.users[0])->when <= current_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            timeout_heap_remove( &abs_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while (rel_timeouts.count && -(timeout = rel_timeouts.users[0])->when <= monotonic_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            timeout_heap_remove( &rel_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
 
         /* now call the callback for all the removed timers */
 
         while ((ptr = list_head( &expired_list )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             list_remove( &timeout->entry );
             timeout->callback( timeout->private );
-            free( timeout );
+            cache_free( timeout, sizeof(*timeout) );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            timeout_t diff = (timeout->when - current_time + 9999) / 10000;
+            timeout_t diff = (abs_timeouts.users[0]->when - current_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            timeout_t diff = (-timeout->when - monotonic_time + 9999) / 10000;
+            timeout_t diff = (-rel_timeouts.users[0]->when - monotonic_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
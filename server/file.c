@@ -416,8 +416,7 @@ static struct security_descriptor *file_get_sd( struct object *obj )
 
     file->mode = st.st_mode;
     file->uid = st.st_uid;
-    free( obj->sd );
-    obj->sd = sd;
+    set_object_sd( obj, sd );
     return sd;
 }
 
@@ -195,6 +195,9 @@ extern struct object *create_user_data_mapping( struct object *root, const struc
                                                 unsigned int attr, const struct security_descriptor *sd );
 extern struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
                                              mem_size_t size, const struct security_descriptor *sd, void **ptr );
+extern struct object *create_client_shared_mapping( struct object *root, const struct unicode_str *name,
+                                                    mem_size_t size, const struct security_descriptor *sd,
+                                                    void **ptr );
 
 /* device functions */
 
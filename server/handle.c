@@ -52,6 +52,7 @@ struct handle_table
     int                  count;       /* number of allocated entries */
     int                  last;        /* last used entry */
     int                  free;        /* first entry that may be free */
+    int                  inherit;     /* number of inheritable entries */
     struct handle_entry *entries;     /* handle entries */
 };
 
@@ -211,6 +212,7 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
     table->count   = count;
     table->last    = -1;
     table->free    = 0;
+    table->inherit = 0;
     if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
     release_object( table );
     return NULL;
@@ -250,6 +252,7 @@ static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned
     table->free = i + 1;
     entry->ptr    = grab_object_for_handle( obj );
     entry->access = access;
+    if (access & RESERVED_INHERIT) table->inherit++;
     return index_to_handle(i);
 }
 
@@ -312,6 +315,14 @@ static obj_handle_t alloc_global_handle( void *obj, unsigned int access )
     return alloc_global_handle_no_access_check( obj, access );
 }
 
+/* change the access of an entry, keeping track of inheritable entries */
+static void set_entry_access( struct handle_table *table, struct handle_entry *entry, unsigned int access )
+{
+    if ((entry->access ^ access) & RESERVED_INHERIT)
+        table->inherit += (access & RESERVED_INHERIT) ? 1 : -1;
+    entry->access = access;
+}
+
 /* return a handle entry, or NULL if the handle is invalid */
 static struct handle_entry *get_handle( struct process *process, obj_handle_t handle )
 {
@@ -354,6 +365,15 @@ static void shrink_handle_table( struct handle_table *table )
     table->entries = new_entries;
 }
 
+/* get the index of an inheritable handle of the parent, or -1 */
+static int get_inherit_index( struct process *parent, const obj_handle_t handle )
+{
+    struct handle_entry *src = get_handle( parent, handle );
+
+    if (!src || !(src->access & RESERVED_INHERIT)) return -1;
+    return handle_to_index( handle );
+}
+
 static void inherit_handle( struct process *parent, const obj_handle_t handle, struct handle_table *table )
 {
     struct handle_entry *dst, *src;
@@ -361,13 +381,13 @@ static void inherit_handle( struct process *parent, const obj_handle_t handle, s
 
     dst = table->entries;
 
-    src = get_handle( parent, handle );
-    if (!src || !(src->access & RESERVED_INHERIT)) return;
-    index = handle_to_index( handle );
+    if ((index = get_inherit_index( parent, handle )) == -1) return;
     if (dst[index].ptr) return;
+    src = get_handle( parent, handle );
     grab_object_for_handle( src->ptr );
     dst[index] = *src;
     table->last = max( table->last, index );
+    table->inherit++;
 }
 
 /* copy the handle table of the parent process */
@@ -378,17 +398,36 @@ struct handle_table *copy_handle_table( struct process *process, struct process
 {
     struct handle_table *parent_table = parent->handles;
     struct handle_table *table;
-    int i;
+    struct handle_entry *ptr;
+    int i, found = 0, last = -1;
 
     assert( parent_table );
     assert( parent_table->obj.ops == &handle_table_ops );
 
-    if (!(table = alloc_handle_table( process, parent_table->count )))
+    /* size the new table for the handles that are actually inherited, processes
+     * with large tables usually only pass down a few of them */
+    if (handles)
+    {
+        for (i = 0; i < handle_count; i++) last = max( last, get_inherit_index( parent, handles[i] ));
+        for (i = 0; i < 3; i++) last = max( last, get_inherit_index( parent, std_handles[i] ));
+    }
+    else
+    {
+        ptr = parent_table->entries;
+        for (i = found = 0; i <= parent_table->last && found < parent_table->inherit; i++, ptr++)
+        {
+            if (!ptr->ptr || !(ptr->access & RESERVED_INHERIT)) continue;
+            last = i;
+            found++;
+        }
+    }
+
+    if (!(table = alloc_handle_table( process, last + 1 )))
         return NULL;
 
     if (handles)
     {
-        memset( table->entries, 0, parent_table->count * sizeof(*table->entries) );
+        memset( table->entries, 0, (last + 1) * sizeof(*table->entries) );
 
         for (i = 0; i < handle_count; i++)
         {
@@ -400,22 +439,18 @@ struct handle_table *copy_handle_table( struct process *process, struct process
             inherit_handle( parent, std_handles[i], table );
         }
     }
-    else
+    else if ((table->last = last) >= 0)
     {
-        if ((table->last = parent_table->last) >= 0)
+        ptr = table->entries;
+        memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
+        for (i = 0; i <= table->last; i++, ptr++)
         {
-            struct handle_entry *ptr = table->entries;
-            memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
-            for (i = 0; i <= table->last; i++, ptr++)
-            {
-                if (!ptr->ptr) continue;
-                if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
-                else ptr->ptr = NULL; /* don't inherit this entry */
-            }
+            if (!ptr->ptr) continue;
+            if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
+            else ptr->ptr = NULL; /* don't inherit this entry */
         }
+        table->inherit = found;
     }
-    /* attempt to shrink the table */
-    shrink_handle_table( table );
     return table;
 }
 
@@ -432,6 +467,7 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
     entry->ptr = NULL;
     table = handle_is_global(handle) ? global_table : process->handles;
+    if (entry->access & RESERVED_INHERIT) table->inherit--;
     if (entry < table->entries + table->free) table->free = entry - table->entries;
     if (entry == table->entries + table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
@@ -543,7 +579,8 @@ static int set_handle_flags( struct process *process, obj_handle_t handle, int m
     old_access = entry->access;
     mask  = (mask << RESERVED_SHIFT) & RESERVED_ALL;
     flags = (flags << RESERVED_SHIFT) & mask;
-    entry->access = (entry->access & ~mask) | flags;
+    set_entry_access( handle_is_global(handle) ? global_table : process->handles, entry,
+                      (entry->access & ~mask) | flags );
     return (old_access & RESERVED_ALL) >> RESERVED_SHIFT;
 }
 
@@ -591,7 +628,7 @@ obj_handle_t duplicate_handle( struct process *src, obj_handle_t src_handle, str
                  entry && !(entry->access & RESERVED_CLOSE_PROTECT))
         {
             if (attr & OBJ_INHERIT) access |= RESERVED_INHERIT;
-            entry->access = access;
+            set_entry_access( handle_is_global(src_handle) ? global_table : src->handles, entry, access );
             res = src_handle;
         }
         else
@@ -126,6 +126,47 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* read-only file holding page-aligned copies of the unaligned sections of a PE image */
+struct aligned_map
+{
+    struct object   obj;             /* object header */
+    struct fd      *fd;              /* file descriptor of the mapped PE file */
+    struct file    *file;            /* temp file holding the aligned data */
+    struct list     entry;           /* entry in aligned maps hash table */
+};
+
+static void aligned_map_dump( struct object *obj, int verbose );
+static void aligned_map_destroy( struct object *obj );
+
+static const struct object_ops aligned_map_ops =
+{
+    sizeof(struct aligned_map), /* size */
+    &no_type,                  /* type */
+    aligned_map_dump,          /* dump */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* get_esync_fd */
+    NULL,                      /* get_fsync_idx */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    default_map_access,        /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_get_full_name,          /* get_full_name */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_kernel_obj_list,        /* get_kernel_obj_list */
+    no_close_handle,           /* close_handle */
+    aligned_map_destroy        /* destroy */
+};
+
+#define ALIGNED_MAP_HASH_SIZE 131
+static struct list aligned_map_hash[ALIGNED_MAP_HASH_SIZE];
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -166,6 +207,7 @@ struct mapping
     pe_image_info_t image;           /* image info (for PE image mapping) */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct aligned_map *aligned;     /* temp file for unaligned PE sections */
     void           *shared_ptr;      /* mmaped pointer for shared mappings */
 };
 
@@ -248,6 +290,21 @@ static void shared_map_destroy( struct object *obj )
     list_remove( &shared->entry );
 }
 
+static void aligned_map_dump( struct object *obj, int verbose )
+{
+    struct aligned_map *aligned = (struct aligned_map *)obj;
+    fprintf( stderr, "Aligned mapping fd=%p file=%p\n", aligned->fd, aligned->file );
+}
+
+static void aligned_map_destroy( struct object *obj )
+{
+    struct aligned_map *aligned = (struct aligned_map *)obj;
+
+    release_object( aligned->fd );
+    release_object( aligned->file );
+    list_remove( &aligned->entry );
+}
+
 /* extend a file beyond the current end of file */
 int grow_file( int unix_fd, file_pos_t new_size )
 {
@@ -573,6 +630,19 @@ static int find_committed_range( struct memory_view *view, file_pos_t start, mem
     return 0;
 }
 
+/* check if a section is writable and shared between processes */
+static inline int is_shared_section( const IMAGE_SECTION_HEADER *sec )
+{
+    return (sec->Characteristics & IMAGE_SCN_MEM_SHARED) && (sec->Characteristics & IMAGE_SCN_MEM_WRITE);
+}
+
+/* check if a section can't be mmapped directly from the file because of its alignment */
+/* such sections get a page-aligned copy in the aligned mapping, so that clients don't need to read them */
+static inline int is_unaligned_section( const IMAGE_SECTION_HEADER *sec, off_t file_start, size_t file_size )
+{
+    return !is_shared_section( sec ) && sec->PointerToRawData && file_size && (file_start & page_mask);
+}
+
 /* allocate and fill the temp file for a shared PE image mapping */
 static int build_shared_mapping( struct mapping *mapping, int fd,
                                  IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
@@ -592,8 +662,7 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     total_size = max_size = 0;
     for (i = 0; i < nb_sec; i++)
     {
-        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) &&
-            (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE))
+        if (is_shared_section( &sec[i] ))
         {
             get_section_sizes( &sec[i], &map_size, &read_pos, &file_size );
             if (file_size > max_size) max_size = file_size;
@@ -616,8 +685,7 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     shared_pos = 0;
     for (i = 0; i < nb_sec; i++)
     {
-        if (!(sec[i].Characteristics & IMAGE_SCN_MEM_SHARED)) continue;
-        if (!(sec[i].Characteristics & IMAGE_SCN_MEM_WRITE)) continue;
+        if (!is_shared_section( &sec[i] )) continue;
         get_section_sizes( &sec[i], &map_size, &read_pos, &file_size );
         write_pos = shared_pos;
         shared_pos += map_size;
@@ -652,6 +720,127 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     return 0;
 }
 
+/* find the page-aligned copy of the unaligned sections of a PE file */
+static struct aligned_map *get_aligned_file( struct fd *fd, unsigned int hash )
+{
+    struct aligned_map *ptr;
+
+    LIST_FOR_EACH_ENTRY( ptr, &aligned_map_hash[hash], struct aligned_map, entry )
+        if (is_same_file_fd( ptr->fd, fd ))
+            return (struct aligned_map *)grab_object( ptr );
+    return NULL;
+}
+
+/* return a read-only file descriptor for a temp file, and prevent any further writes to it */
+static int seal_temp_file( int fd )
+{
+    char path[32];
+    int ro_fd;
+
+#ifdef HAVE_MEMFD_CREATE
+    if (fcntl( fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL ) == -1) return -1;
+#endif
+    sprintf( path, "/proc/self/fd/%u", fd );
+    ro_fd = open( path, O_RDONLY );
+    close( fd );
+    return ro_fd;
+}
+
+/* allocate and fill the temp file holding page-aligned copies of the unaligned sections of a PE image */
+/* it is only handed out read-only, so that clients can map it copy-on-write but not modify it */
+static void build_aligned_mapping( struct mapping *mapping, int fd,
+                                   IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
+{
+    struct aligned_map *aligned;
+    struct file *file;
+    struct stat st;
+    unsigned int i, hash;
+    mem_size_t total_size;
+    size_t file_size, map_size, max_size;
+    off_t aligned_pos, read_pos, write_pos;
+    char *buffer;
+    int aligned_fd;
+    long toread;
+
+    if (mapping->image.image_flags & IMAGE_FLAGS_ImageMappedFlat) return;
+
+    total_size = max_size = 0;
+    for (i = 0; i < nb_sec; i++)
+    {
+        get_section_sizes( &sec[i], &map_size, &read_pos, &file_size );
+        if (!is_unaligned_section( &sec[i], read_pos, file_size )) continue;
+        if (file_size > max_size) max_size = file_size;
+        total_size += ROUND_SIZE( file_size );
+    }
+    if (!total_size) return;  /* nothing to do */
+
+    if (fstat( fd, &st ) == -1) return;
+    hash = st.st_ino % ALIGNED_MAP_HASH_SIZE;
+    if (!aligned_map_hash[hash].next)
+        for (i = 0; i < ALIGNED_MAP_HASH_SIZE; i++) list_init( &aligned_map_hash[i] );
+    if ((mapping->aligned = get_aligned_file( mapping->fd, hash ))) return;
+
+    /* this is only an optimization, clients read the sections themselves if anything fails */
+
+    if ((aligned_fd = create_temp_file( total_size )) == -1)
+    {
+        clear_error();
+        return;
+    }
+    if (!(buffer = malloc( max_size )))
+    {
+        close( aligned_fd );
+        clear_error();
+        return;
+    }
+
+    aligned_pos = 0;
+    for (i = 0; i < nb_sec; i++)
+    {
+        get_section_sizes( &sec[i], &map_size, &read_pos, &file_size );
+        if (!is_unaligned_section( &sec[i], read_pos, file_size )) continue;
+        write_pos = aligned_pos;
+        aligned_pos += ROUND_SIZE( file_size );
+        toread = file_size;
+        while (toread)
+        {
+            long res = pread( fd, buffer + file_size - toread, toread, read_pos );
+            if (res <= 0)
+            {
+                /* truncated files are reported by the client when mapping the section */
+                file_size -= toread;
+                break;
+            }
+            toread -= res;
+            read_pos += res;
+        }
+        if (pwrite( aligned_fd, buffer, file_size, write_pos ) != file_size) break;
+    }
+    free( buffer );
+
+    if (i < nb_sec)
+    {
+        close( aligned_fd );
+        return;
+    }
+    if ((aligned_fd = seal_temp_file( aligned_fd )) == -1) return;
+    if (!(file = create_file_for_fd( aligned_fd, FILE_GENERIC_READ, 0 )))
+    {
+        clear_error();
+        return;
+    }
+    if (!(aligned = alloc_object( &aligned_map_ops )))
+    {
+        release_object( file );
+        clear_error();
+        return;
+    }
+    aligned->fd = (struct fd *)grab_object( mapping->fd );
+    aligned->file = file;
+    list_add_head( &aligned_map_hash[hash], &aligned->entry );
+    mapping->aligned = aligned;
+}
+
 /* load the CLR header from its section */
 static int load_clr_header( IMAGE_COR20_HEADER *hdr, size_t va, size_t size, int unix_fd,
                             IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
@@ -844,6 +1033,7 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
 
     if (!build_shared_mapping( mapping, unix_fd, sec, nt.FileHeader.NumberOfSections ))
         return STATUS_INVALID_FILE_FOR_SECTION;
+    build_aligned_mapping( mapping, unix_fd, sec, nt.FileHeader.NumberOfSections );
 
     return STATUS_SUCCESS;
 }
@@ -906,6 +1096,7 @@ static struct mapping *create_mapping( struct object *root, const struct unicode
     mapping->size        = size;
     mapping->fd          = NULL;
     mapping->shared      = NULL;
+    mapping->aligned     = NULL;
     mapping->committed   = NULL;
     mapping->shared_ptr  = MAP_FAILED;
 
@@ -996,6 +1187,7 @@ struct mapping *create_fd_mapping( struct object *root, const struct unicode_str
     if (get_error() == STATUS_OBJECT_NAME_EXISTS) return mapping;  /* Nothing else to do */
 
     mapping->shared    = NULL;
+    mapping->aligned   = NULL;
     mapping->committed = NULL;
     mapping->flags     = SEC_FILE;
     mapping->fd        = (struct fd *)grab_object( fd );
@@ -1108,6 +1300,7 @@ static void mapping_destroy( struct object *obj )
     if (mapping->fd) release_object( mapping->fd );
     if (mapping->committed) release_object( mapping->committed );
     if (mapping->shared) release_object( mapping->shared );
+    if (mapping->aligned) release_object( mapping->aligned );
     if (mapping->shared_ptr != MAP_FAILED) munmap( mapping->shared_ptr, mapping->size );
 }
 
@@ -1144,10 +1337,10 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     return &mapping->obj;
 }
 
-struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
-                                      mem_size_t size, const struct security_descriptor *sd, void **ptr )
+static struct object *create_sealed_mapping( struct object *root, const struct unicode_str *name,
+                                             mem_size_t size, const struct security_descriptor *sd,
+                                             void **ptr, int seals )
 {
-    static int seals = F_SEAL_FUTURE_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
     struct mapping *mapping;
 
     if (!(mapping = create_mapping( root, name, OBJ_OPENIF, size, SEC_COMMIT, 0,
@@ -1170,6 +1363,21 @@ struct object *create_shared_mapping( struct object *root, const struct unicode_
     return &mapping->obj;
 }
 
+/* create a mapping that clients can only map read-only */
+struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
+                                      mem_size_t size, const struct security_descriptor *sd, void **ptr )
+{
+    return create_sealed_mapping( root, name, size, sd, ptr,
+                                  F_SEAL_FUTURE_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL );
+}
+
+/* create a mapping that clients can write to, its contents can't be trusted */
+struct object *create_client_shared_mapping( struct object *root, const struct unicode_str *name,
+                                             mem_size_t size, const struct security_descriptor *sd, void **ptr )
+{
+    return create_sealed_mapping( root, name, size, sd, ptr, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL );
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
@@ -1240,6 +1448,8 @@ DECL_HANDLER(get_mapping_info)
     if (mapping->shared)
         reply->shared_file = alloc_handle( current->process, mapping->shared->file,
                                            GENERIC_READ|GENERIC_WRITE, 0 );
+    if (mapping->aligned)
+        reply->aligned_file = alloc_handle( current->process, mapping->aligned->file, GENERIC_READ, 0 );
     release_object( mapping );
 }
 
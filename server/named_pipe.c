@@ -388,7 +388,7 @@ static struct pipe_message *queue_message( struct pipe_end *pipe_end, struct ios
 {
     struct pipe_message *message;
 
-    if (!(message = mem_alloc( sizeof(*message) ))) return NULL;
+    if (!(message = cache_alloc( sizeof(*message) ))) return NULL;
     message->iosb = (struct iosb *)grab_object( iosb );
     message->async = NULL;
     message->read_pos = 0;
@@ -411,7 +411,7 @@ static void free_message( struct pipe_message *message )
 {
     list_remove( &message->entry );
     if (message->iosb) release_object( message->iosb );
-    free( message );
+    cache_free( message, sizeof(*message) );
 }
 
 static void pipe_end_disconnect( struct pipe_end *pipe_end, unsigned int status )
@@ -538,7 +538,7 @@ static void named_pipe_device_destroy( struct object *obj )
 {
     struct named_pipe_device *device = (struct named_pipe_device*)obj;
     assert( obj->ops == &named_pipe_device_ops );
-    free( device->pipes );
+    free_namespace( device->pipes );
 }
 
 struct object *create_named_pipe_device( struct object *root, const struct unicode_str *name,
@@ -806,8 +806,9 @@ static void message_queue_read( struct pipe_end *pipe_end, struct async *async )
         out_size = min( iosb->out_size, avail );
     }
 
+    /* if the read consumes exactly the head message, hand its data over instead of copying it */
     message = LIST_ENTRY( list_head(&pipe_end->message_queue), struct pipe_message, entry );
-    if (!message->read_pos && message->iosb->in_size == iosb->out_size) /* fast path */
+    if (!message->read_pos && message->iosb->in_size == out_size) /* fast path */
     {
         async_request_complete( async, status, out_size, out_size, message->iosb->in_data );
         message->iosb->in_data = NULL;
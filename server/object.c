@@ -46,9 +46,12 @@
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the table */
+    struct list        *names;           /* array of hash entry lists */
 };
 
+#define NAMESPACE_MAX_LOAD 2  /* average chain length that triggers growing the table */
+
 
 struct type_descr no_type =
 {
@@ -133,12 +136,115 @@ void *memdup( const void *data, size_t len )
 
 
 /*****************************************************************/
+/* caches for small fixed-size blocks, carved out of larger slabs */
+
+#define CACHE_GRANULARITY 16
+#define CACHE_MAX_SIZE    512
+#define CACHE_SLAB_SIZE   (16 * 1024)
+
+struct cache_block
+{
+    struct cache_block *next;            /* next free block of the same size */
+};
+
+struct cache_class
+{
+    struct cache_block *free_list;       /* list of free blocks */
+    char               *slab_pos;        /* next unused block in the current slab */
+    char               *slab_end;        /* end of the current slab */
+};
+
+static struct cache_class cache_classes[CACHE_MAX_SIZE / CACHE_GRANULARITY];
+
+/* allocate a block from the cache of the given size; it must be freed with cache_free */
+void *cache_alloc( size_t size )
+{
+    struct cache_class *class;
+    void *ptr;
+
+    if (!size || size > CACHE_MAX_SIZE) return mem_alloc( size );
+
+    class = &cache_classes[(size - 1) / CACHE_GRANULARITY];
+    size = (size + CACHE_GRANULARITY - 1) & ~(CACHE_GRANULARITY - 1);
+
+    if (class->free_list)
+    {
+        ptr = class->free_list;
+        class->free_list = class->free_list->next;
+    }
+    else
+    {
+        if (!class->slab_pos || class->slab_pos + size > class->slab_end)
+        {
+            if (!(class->slab_pos = malloc( CACHE_SLAB_SIZE )))
+            {
+                class->slab_end = NULL;
+                set_error( STATUS_NO_MEMORY );
+                return NULL;
+            }
+            class->slab_end = class->slab_pos + CACHE_SLAB_SIZE;
+        }
+        ptr = class->slab_pos;
+        class->slab_pos += size;
+    }
+    mark_block_uninitialized( ptr, size );
+    return ptr;
+}
+
+/* return a block allocated with cache_alloc to its cache */
+void cache_free( void *ptr, size_t size )
+{
+    struct cache_class *class;
+    struct cache_block *block = ptr;
+
+    if (!ptr) return;
+    if (!size || size > CACHE_MAX_SIZE)
+    {
+        free( ptr );
+        return;
+    }
+
+    class = &cache_classes[(size - 1) / CACHE_GRANULARITY];
+    block->next = class->free_list;
+    class->free_list = block;
+}
+
+
+/*****************************************************************/
+
+/* grow the hash table of a namespace and move the existing names over */
+static void grow_namespace( struct namespace *namespace )
+{
+    unsigned int i, hash, new_size = namespace->hash_size * 2 + 1;
+    struct object_name *ptr, *next;
+    struct list *names;
+
+    if (!(names = malloc( new_size * sizeof(*names) ))) return;  /* keep the current table */
+    for (i = 0; i < new_size; i++) list_init( &names[i] );
+
+    for (i = 0; i < namespace->hash_size; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE_REV( ptr, next, &namespace->names[i], struct object_name, entry )
+        {
+            hash = hash_strW( ptr->name, ptr->len, new_size );
+            list_remove( &ptr->entry );
+            list_add_head( &names[hash], &ptr->entry );
+        }
+    }
+    free( namespace->names );
+    namespace->names = names;
+    namespace->hash_size = new_size;
+}
 
 void namespace_add( struct namespace *namespace, struct object_name *ptr )
 {
-    unsigned int hash = hash_strW( ptr->name, ptr->len, namespace->hash_size );
+    unsigned int hash;
 
+    if (namespace->count >= namespace->hash_size * NAMESPACE_MAX_LOAD) grow_namespace( namespace );
+    hash = hash_strW( ptr->name, ptr->len, namespace->hash_size );
     list_add_head( &namespace->names[hash], &ptr->entry );
+    ptr->namespace = namespace;
+    namespace->count++;
 }
 
 /* allocate a name for an object */
@@ -150,6 +256,7 @@ static struct object_name *alloc_name( const struct unicode_str *name )
     {
         ptr->len = name->len;
         ptr->parent = NULL;
+        ptr->namespace = NULL;
         memcpy( ptr->name, name->str, name->len );
     }
     return ptr;
@@ -196,7 +303,7 @@ WCHAR *default_get_full_name( struct object *obj, data_size_t *ret_len )
 /* allocate and initialize an object */
 void *alloc_object( const struct object_ops *ops )
 {
-    struct object *obj = mem_alloc( ops->size );
+    struct object *obj = cache_alloc( ops->size );
     if (obj)
     {
         obj->refcount     = 1;
@@ -205,6 +312,7 @@ void *alloc_object( const struct object_ops *ops )
         obj->ops          = ops;
         obj->name         = NULL;
         obj->sd           = NULL;
+        obj->sd_serial    = 0;
         list_init( &obj->wait_queue );
 #ifdef DEBUG_OBJECTS
         list_add_head( &object_list, &obj->obj_list );
@@ -216,16 +324,29 @@ void *alloc_object( const struct object_ops *ops )
     return NULL;
 }
 
+/* replace the security descriptor of an object, the new one is owned by the object */
+void set_object_sd( struct object *obj, struct security_descriptor *sd )
+{
+    static unsigned int serial;
+
+    free( obj->sd );
+    obj->sd = sd;
+    if (!++serial) serial = 1;  /* 0 means no descriptor has been set */
+    obj->sd_serial = serial;
+}
+
 /* free an object once it has been destroyed */
 static void free_object( struct object *obj )
 {
+    size_t size = obj->ops->size;
+
     free( obj->sd );
     obj->ops->type->obj_count--;
 #ifdef DEBUG_OBJECTS
     list_remove( &obj->obj_list );
-    memset( obj, 0xaa, obj->ops->size );
+    memset( obj, 0xaa, size );
 #endif
-    free( obj );
+    cache_free( obj, size );
 }
 
 /* find an object by name starting from the specified root */
@@ -495,15 +616,26 @@ struct namespace *create_namespace( unsigned int hash_size )
     struct namespace *namespace;
     unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = mem_alloc( hash_size * sizeof(namespace->names[0]) )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size      = hash_size;
+    namespace->count          = 0;
+    for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
     return namespace;
 }
 
+/* free a namespace; it must not contain any names anymore */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+    free( namespace->names );
+    free( namespace );
+}
+
 /* functions for unimplemented/default object operations */
 
 int no_add_queue( struct object *obj, struct wait_queue_entry *entry )
@@ -658,8 +790,7 @@ int set_sd_defaults_from_token( struct object *obj, const struct security_descri
     memcpy( ptr, dacl, new_sd.dacl_len );
 
     free( replaced_sacl );
-    free( obj->sd );
-    obj->sd = new_sd_ptr;
+    set_object_sd( obj, new_sd_ptr );
     return 1;
 }
 
@@ -691,6 +822,7 @@ int no_link_name( struct object *obj, struct object_name *name, struct object *p
 void default_unlink_name( struct object *obj, struct object_name *name )
 {
     list_remove( &name->entry );
+    if (name->namespace) name->namespace->count--;
 }
 
 struct object *no_open_file( struct object *obj, unsigned int access, unsigned int sharing,
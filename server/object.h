@@ -121,6 +121,7 @@ struct object
     struct list               wait_queue;
     struct object_name       *name;
     struct security_descriptor *sd;
+    unsigned int              sd_serial;   /* serial number of the current security descriptor */
     unsigned int              is_permanent:1;
 #ifdef DEBUG_OBJECTS
     struct list               obj_list;
@@ -132,6 +133,7 @@ struct object_name
     struct list         entry;           /* entry in the hash list */
     struct object      *obj;             /* object owning this name */
     struct object      *parent;          /* parent object */
+    struct namespace   *namespace;       /* namespace containing the name */
     data_size_t         len;             /* name length in bytes */
     WCHAR               name[1];
 };
@@ -145,7 +147,10 @@ struct wait_queue_entry
 
 extern void *mem_alloc( size_t size );  /* malloc wrapper */
 extern void *memdup( const void *data, size_t len );
+extern void *cache_alloc( size_t size );
+extern void cache_free( void *ptr, size_t size );
 extern void *alloc_object( const struct object_ops *ops );
+extern void set_object_sd( struct object *obj, struct security_descriptor *sd );
 extern void namespace_add( struct namespace *namespace, struct object_name *ptr );
 extern const WCHAR *get_object_name( struct object *obj, data_size_t *len );
 extern WCHAR *default_get_full_name( struct object *obj, data_size_t *ret_len );
@@ -160,6 +165,7 @@ extern void *open_named_object( struct object *parent, const struct object_ops *
                                 const struct unicode_str *name, unsigned int attributes );
 extern void unlink_named_object( struct object *obj );
 extern struct namespace *create_namespace( unsigned int hash_size );
+extern void free_namespace( struct namespace *namespace );
 extern void free_kernel_objects( struct object *obj );
 /* grab/release_object can take any pointer, but you better make sure */
 /* that the thing pointed to starts with a struct object... */
@@ -140,6 +140,7 @@ struct msg_queue
     unsigned int           fsync_idx;
     int                    fsync_in_msgwait; /* our thread is currently waiting on us */
     volatile struct queue_shared_memory *shared;  /* thread queue shared memory ptr */
+    volatile struct queue_client_memory *client;  /* thread queue client writable memory ptr */
 };
 
 struct hotkey
@@ -371,6 +372,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->fsync_idx       = 0;
         queue->fsync_in_msgwait = 0;
         queue->shared          = thread->queue_shared;
+        queue->client          = thread->queue_client;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -386,6 +388,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         SHARED_WRITE_BEGIN( &queue->shared->seq );
         queue->shared->created = TRUE;
         SHARED_WRITE_END( &queue->shared->seq );
+        __atomic_store_n( &queue->client->posted_read, queue->shared->posted_write, __ATOMIC_RELEASE );
         thread->queue = queue;
     }
     if (new_input)
@@ -466,10 +469,10 @@ static struct message *alloc_hardware_message( lparam_t info, struct hw_msg_sour
     struct hardware_msg_data *msg_data;
     struct message *msg;
 
-    if (!(msg = mem_alloc( sizeof(*msg) ))) return NULL;
+    if (!(msg = cache_alloc( sizeof(*msg) ))) return NULL;
     if (!(msg_data = mem_alloc( sizeof(*msg_data) + extra_size )))
     {
-        free( msg );
+        cache_free( msg, sizeof(*msg) );
         return NULL;
     }
     memset( msg, 0, sizeof(*msg) );
@@ -606,13 +609,16 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
         if (!queue->keystate_lock) lock_input_keystate( queue->input );
         queue->keystate_lock = 1;
     }
-    queue->wake_bits |= bits;
-    queue->changed_bits |= bits;
+    if ((queue->wake_bits & bits) != bits || (queue->changed_bits & bits) != bits)
+    {
+        queue->wake_bits |= bits;
+        queue->changed_bits |= bits;
 
-    SHARED_WRITE_BEGIN( &queue->shared->seq );
-    queue->shared->wake_bits = queue->wake_bits;
-    queue->shared->changed_bits = queue->changed_bits;
-    SHARED_WRITE_END( &queue->shared->seq );
+        SHARED_WRITE_BEGIN( &queue->shared->seq );
+        queue->shared->wake_bits = queue->wake_bits;
+        queue->shared->changed_bits = queue->changed_bits;
+        SHARED_WRITE_END( &queue->shared->seq );
+    }
 
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
@@ -835,7 +841,7 @@ static void free_message( struct message *msg )
         store_message_result( result, 0, STATUS_ACCESS_DENIED /*FIXME*/ );
     }
     free( msg->data );
-    free( msg );
+    cache_free( msg, sizeof(*msg) );
 }
 
 /* remove (and free) a message from a message list */
@@ -858,6 +864,82 @@ static void remove_queue_message( struct msg_queue *queue, struct message *msg,
     free_message( msg );
 }
 
+/* check the posted ring read index set by the client, an invalid index means that the ring is empty */
+static unsigned int get_valid_posted_read( struct msg_queue *queue, unsigned int read )
+{
+    unsigned int write = queue->shared->posted_write;
+
+    if (write - read > SHARED_POSTED_MESSAGES) return write;
+    return read;
+}
+
+/* queue a posted message, storing it in the shared memory ring when the client can consume it directly */
+static void queue_posted_message( struct msg_queue *queue, struct message *msg )
+{
+    volatile struct queue_shared_memory *shared = queue->shared;
+    volatile struct shared_posted_message *posted;
+    unsigned int write = shared->posted_write;
+    unsigned int read = get_valid_posted_read( queue, __atomic_load_n( &queue->client->posted_read,
+                                                                         __ATOMIC_ACQUIRE ));
+
+    /* ring messages must all be older than the list ones to keep the ordering */
+    if (msg->data || msg->msg == WM_HOTKEY || !list_empty( &queue->msg_list[POST_MESSAGE] ) ||
+        write - read >= SHARED_POSTED_MESSAGES)
+    {
+        list_add_tail( &queue->msg_list[POST_MESSAGE], &msg->entry );
+        return;
+    }
+
+    posted = &shared->posted[write % SHARED_POSTED_MESSAGES];
+    posted->win    = msg->win;
+    posted->msg    = msg->msg;
+    posted->wparam = msg->wparam;
+    posted->lparam = msg->lparam;
+    posted->x      = msg->x;
+    posted->y      = msg->y;
+    posted->time   = msg->time;
+    __atomic_store_n( &shared->posted_write, write + 1, __ATOMIC_RELEASE );
+    free_message( msg );
+}
+
+/* move the posted messages not consumed by the client back to the head of the queue list */
+static void flush_posted_messages( struct msg_queue *queue )
+{
+    volatile struct queue_shared_memory *shared = queue->shared;
+    unsigned int read, write = shared->posted_write;
+    struct list *prev = &queue->msg_list[POST_MESSAGE];
+    struct message *msg;
+
+    /* claim all the remaining entries, the client may be consuming them concurrently */
+    read = __atomic_exchange_n( &queue->client->posted_read, write, __ATOMIC_ACQ_REL );
+    read = get_valid_posted_read( queue, read );
+
+    for (; read != write; read++)
+    {
+        volatile struct shared_posted_message *posted = &shared->posted[read % SHARED_POSTED_MESSAGES];
+
+        if (!(msg = cache_alloc( sizeof(*msg) ))) break;
+        msg->type      = MSG_POSTED;
+        msg->win       = posted->win;
+        msg->msg       = posted->msg;
+        msg->wparam    = posted->wparam;
+        msg->lparam    = posted->lparam;
+        msg->x         = posted->x;
+        msg->y         = posted->y;
+        msg->time      = posted->time;
+        msg->result    = NULL;
+        msg->data      = NULL;
+        msg->data_size = 0;
+        list_add_after( prev, &msg->entry );
+        prev = &msg->entry;
+    }
+
+    /* the client doesn't clear the bits when it empties the ring */
+    if ((queue->wake_bits & QS_POSTMESSAGE) && list_empty( &queue->msg_list[POST_MESSAGE] ) &&
+        !queue->quit_message)
+        clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
+}
+
 /* message timed out without getting a reply */
 static void result_timeout( void *private )
 {
@@ -900,7 +982,7 @@ static struct message_result *alloc_message_result( struct msg_queue *send_queue
 
         if (msg->type == MSG_CALLBACK)
         {
-            struct message *callback_msg = mem_alloc( sizeof(*callback_msg) );
+            struct message *callback_msg = cache_alloc( sizeof(*callback_msg) );
 
             if (!callback_msg)
             {
@@ -966,7 +1048,7 @@ static void receive_message( struct msg_queue *queue, struct message *msg,
         result->recv_next  = queue->recv_result;
         queue->recv_result = result;
     }
-    free( msg );
+    cache_free( msg, sizeof(*msg) );
     if (list_empty( &queue->msg_list[SEND_MESSAGE] )) clear_queue_bits( queue, QS_SENDMESSAGE );
 }
 
@@ -1887,7 +1969,7 @@ static int send_hook_ll_message( struct desktop *desktop, struct message *hardwa
     if (!(queue = hook_thread->queue)) return 0;
     if (is_queue_hung( queue )) return 0;
 
-    if (!(msg = mem_alloc( sizeof(*msg) ))) return 0;
+    if (!(msg = cache_alloc( sizeof(*msg) ))) return 0;
 
     msg->type      = MSG_HOOK_LL;
     msg->win       = 0;
@@ -2582,6 +2664,7 @@ void queue_cleanup_window( struct thread *thread, user_handle_t win )
     }
 
     /* remove messages */
+    flush_posted_messages( queue );
     for (i = 0; i < NB_MSG_KINDS; i++)
     {
         struct list *ptr, *next;
@@ -2612,7 +2695,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
 
     if (!thread) return;
 
-    if (thread->queue && (msg = mem_alloc( sizeof(*msg) )))
+    if (thread->queue && (msg = cache_alloc( sizeof(*msg) )))
     {
         msg->type      = MSG_POSTED;
         msg->win       = get_user_full_handle( win );
@@ -2625,7 +2708,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
 
         get_message_defaults( thread->queue, &msg->x, &msg->y, &msg->time );
 
-        list_add_tail( &thread->queue->msg_list[POST_MESSAGE], &msg->entry );
+        queue_posted_message( thread->queue, msg );
         set_queue_bits( thread->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (message == WM_HOTKEY)
         {
@@ -2644,7 +2727,7 @@ void send_notify_message( user_handle_t win, unsigned int message, lparam_t wpar
 
     if (!thread) return;
 
-    if (thread->queue && (msg = mem_alloc( sizeof(*msg) )))
+    if (thread->queue && (msg = cache_alloc( sizeof(*msg) )))
     {
         msg->type      = MSG_NOTIFY;
         msg->win       = get_user_full_handle( win );
@@ -2672,7 +2755,7 @@ void post_win_event( struct thread *thread, unsigned int event,
 {
     struct message *msg;
 
-    if (thread->queue && (msg = mem_alloc( sizeof(*msg) )))
+    if (thread->queue && (msg = cache_alloc( sizeof(*msg) )))
     {
         struct winevent_msg_data *data;
 
@@ -2701,7 +2784,7 @@ void post_win_event( struct thread *thread, unsigned int event,
             set_queue_bits( thread->queue, QS_SENDMESSAGE );
         }
         else
-            free( msg );
+            cache_free( msg, sizeof(*msg) );
     }
 }
 
@@ -2761,6 +2844,19 @@ DECL_HANDLER(get_msg_queue)
 }
 
 
+/* get the client writable memory mapping of the current thread queue */
+DECL_HANDLER(get_queue_client_mapping)
+{
+    if (!current->queue_client_mapping)
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    reply->handle = alloc_handle( current->process, current->queue_client_mapping,
+                                  SECTION_QUERY | SECTION_MAP_READ | SECTION_MAP_WRITE, 0 );
+}
+
+
 /* set the file descriptor associated to the current thread queue */
 DECL_HANDLER(set_queue_fd)
 {
@@ -2873,7 +2969,7 @@ DECL_HANDLER(send_message)
         return;
     }
 
-    if ((msg = mem_alloc( sizeof(*msg) )))
+    if ((msg = cache_alloc( sizeof(*msg) )))
     {
         msg->type      = req->type;
         msg->win       = get_user_full_handle( req->win );
@@ -2888,7 +2984,7 @@ DECL_HANDLER(send_message)
 
         if (msg->data_size && !(msg->data = memdup( get_req_data(), msg->data_size )))
         {
-            free( msg );
+            cache_free( msg, sizeof(*msg) );
             release_object( thread );
             return;
         }
@@ -2910,9 +3006,9 @@ DECL_HANDLER(send_message)
             set_queue_bits( recv_queue, QS_SENDMESSAGE );
             break;
         case MSG_POSTED:
-            list_add_tail( &recv_queue->msg_list[POST_MESSAGE], &msg->entry );
+            queue_posted_message( recv_queue, msg );
             set_queue_bits( recv_queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
-            if (msg->msg == WM_HOTKEY)
+            if (req->msg == WM_HOTKEY)
             {
                 set_queue_bits( recv_queue, QS_HOTKEY );
                 recv_queue->hotkey_count++;
@@ -2923,7 +3019,7 @@ DECL_HANDLER(send_message)
         case MSG_HOOK_LL:  /* generated internally */
         default:
             set_error( STATUS_INVALID_PARAMETER );
-            free( msg );
+            cache_free( msg, sizeof(*msg) );
             break;
         }
     }
@@ -3006,6 +3102,7 @@ DECL_HANDLER(get_message)
     if (!queue) return;
     queue->last_get_msg = current_time;
     if (!filter) filter = QS_ALLINPUT;
+    flush_posted_messages( queue );
 
     /* first check for sent messages */
     if ((ptr = list_head( &queue->msg_list[SEND_MESSAGE] )))
@@ -3569,6 +3666,7 @@ DECL_HANDLER(set_active_window)
 
             if (desktop->foreground_input == queue->input && req->handle != reply->previous)
             {
+                flush_posted_messages( queue );
                 LIST_FOR_EACH_ENTRY_SAFE( msg, next, &queue->msg_list[POST_MESSAGE], struct message, entry )
                     if (msg->msg == req->internal_msg) remove_queue_message( queue, msg, POST_MESSAGE );
             }
@@ -3751,53 +3849,45 @@ DECL_HANDLER(get_cursor_history)
 DECL_HANDLER(get_rawinput_buffer)
 {
     struct thread_input *input = current->queue->input;
-    data_size_t size = 0, next_size = 0;
-    struct list *ptr;
-    char *buf, *cur, *tmp;
-    int count = 0, buf_size = 16 * sizeof(struct hardware_msg_data);
-
-    if (!req->buffer_size) buf = NULL;
-    else if (!(buf = mem_alloc( buf_size ))) return;
+    data_size_t size = 0, next_size = 0, total = 0;
+    struct message *msg, *next;
+    int count = 0;
+    char *buf = NULL;
 
-    cur = buf;
-    ptr = list_head( &input->msg_list );
-    while (ptr)
+    /* first find out how many messages fit, so that the reply can be built in place */
+    LIST_FOR_EACH_ENTRY( msg, &input->msg_list, struct message, entry )
     {
-        struct message *msg = LIST_ENTRY( ptr, struct message, entry );
         struct hardware_msg_data *data = msg->data;
-        data_size_t extra_size = data->size - sizeof(*data);
 
-        ptr = list_next( &input->msg_list, ptr );
         if (msg->msg != WM_INPUT) continue;
 
-        next_size = req->rawinput_size + extra_size;
+        next_size = req->rawinput_size + data->size - sizeof(*data);
         if (size + next_size > req->buffer_size) break;
-        if (cur + data->size > buf + get_reply_max_size()) break;
-        if (cur + data->size > buf + buf_size)
-        {
-            buf_size += buf_size / 2 + extra_size;
-            if (!(tmp = realloc( buf, buf_size )))
-            {
-                set_error( STATUS_NO_MEMORY );
-                return;
-            }
-            cur = tmp + (cur - buf);
-            buf = tmp;
-        }
-
-        memcpy( cur, data, data->size );
-        list_remove( &msg->entry );
-        free_message( msg );
+        if (total + data->size > get_reply_max_size()) break;
 
         size += next_size;
-        cur += sizeof(*data) + extra_size;
-
+        total += data->size;
         count++;
     }
 
+    if (count && !(buf = set_reply_data_size( total ))) return;
+
     reply->next_size = next_size;
     reply->count = count;
-    set_reply_data_ptr( buf, cur - buf );
+
+    LIST_FOR_EACH_ENTRY_SAFE( msg, next, &input->msg_list, struct message, entry )
+    {
+        struct hardware_msg_data *data = msg->data;
+
+        if (!count) break;
+        if (msg->msg != WM_INPUT) continue;
+
+        memcpy( buf, data, data->size );
+        buf += data->size;
+        list_remove( &msg->entry );
+        free_message( msg );
+        count--;
+    }
 }
 
 DECL_HANDLER(update_rawinput_devices)
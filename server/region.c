@@ -105,6 +105,13 @@ typedef int (*non_overlap_func_t)( struct region *reg, const rectangle_t *r,
 
 static const rectangle_t empty_rect;  /* all-zero rectangle for empty regions */
 
+/* check if a rectangle fully contains another one */
+static inline int rect_contains( const rectangle_t *outer, const rectangle_t *inner )
+{
+    return (outer->left <= inner->left && outer->top <= inner->top &&
+            outer->right >= inner->right && outer->bottom >= inner->bottom);
+}
+
 /* add a rectangle to a region */
 static inline rectangle_t *add_rect( struct region *reg )
 {
@@ -219,14 +226,19 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     const rectangle_t *r1End = r1 + reg1->num_rects;
     const rectangle_t *r2End = r2 + reg2->num_rects;
 
-    rectangle_t *new_rects, *old_rects = newReg->rects;
+    rectangle_t *new_rects, *old_rects = NULL;
     int new_size, ret = 0;
 
-    new_size = max( reg1->num_rects, reg2->num_rects ) * 2;
-    if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
+    /* the destination rectangles can be reused unless they are also a source */
+    if (newReg == reg1 || newReg == reg2)
+    {
+        new_size = max( reg1->num_rects, reg2->num_rects ) * 2;
+        if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
 
-    newReg->size = new_size;
-    newReg->rects = new_rects;
+        old_rects = newReg->rects;
+        newReg->size = new_size;
+        newReg->rects = new_rects;
+    }
     newReg->num_rects = 0;
 
     if (reg1->extents.top < reg2->extents.top)
@@ -762,6 +774,8 @@ struct region *copy_region( struct region *dst, const struct region *src )
 struct region *intersect_region( struct region *dst, const struct region *src1,
                                  const struct region *src2 )
 {
+    rectangle_t rect;
+
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
     {
         dst->num_rects = 0;
@@ -771,6 +785,18 @@ struct region *intersect_region( struct region *dst, const struct region *src1,
         dst->extents.bottom = 0;
         return dst;
     }
+
+    if (src1->num_rects == 1 && src2->num_rects == 1)
+    {
+        intersect_rect( &rect, &src1->extents, &src2->extents );
+        set_region_rect( dst, &rect );
+        return dst;
+    }
+    if (src1->num_rects == 1 && rect_contains( &src1->extents, &src2->extents ))
+        return copy_region( dst, src2 );
+    if (src2->num_rects == 1 && rect_contains( &src2->extents, &src1->extents ))
+        return copy_region( dst, src1 );
+
     if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
@@ -783,6 +809,12 @@ struct region *subtract_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
         return copy_region( dst, src1 );
 
+    if (src2->num_rects == 1 && rect_contains( &src2->extents, &src1->extents ))
+    {
+        set_region_rect( dst, &empty_rect );
+        return dst;
+    }
+
     if (!region_op( dst, src1, src2, subtract_overlapping,
                     subtract_non_overlapping, NULL )) return NULL;
     set_region_extents( dst );
@@ -797,18 +829,10 @@ struct region *union_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects) return copy_region( dst, src2 );
     if (!src2->num_rects) return copy_region( dst, src1 );
 
-    if ((src1->num_rects == 1) &&
-        (src1->extents.left <= src2->extents.left) &&
-        (src1->extents.top <= src2->extents.top) &&
-        (src1->extents.right >= src2->extents.right) &&
-        (src1->extents.bottom >= src2->extents.bottom))
+    if (src1->num_rects == 1 && rect_contains( &src1->extents, &src2->extents ))
         return copy_region( dst, src1 );
 
-    if ((src2->num_rects == 1) &&
-        (src2->extents.left <= src1->extents.left) &&
-        (src2->extents.top <= src1->extents.top) &&
-        (src2->extents.right >= src1->extents.right) &&
-        (src2->extents.bottom >= src1->extents.bottom))
+    if (src2->num_rects == 1 && rect_contains( &src2->extents, &src1->extents ))
         return copy_region( dst, src2 );
 
     if (!region_op( dst, src1, src2, union_overlapping,
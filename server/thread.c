@@ -295,6 +295,8 @@ static inline void init_thread_structure( struct thread *thread )
     thread->desc_len        = 0;
     thread->queue_shared_mapping = NULL;
     thread->queue_shared         = NULL;
+    thread->queue_client_mapping = NULL;
+    thread->queue_client         = NULL;
     thread->input_shared_mapping = NULL;
     thread->input_shared         = NULL;
 
@@ -362,15 +364,20 @@ static volatile void *init_queue_mapping( struct thread *thread )
 
     thread->queue_shared_mapping = create_shared_mapping( dir, &name, sizeof(struct queue_shared_memory),
                                                           NULL, (void **)&thread->queue_shared );
-    release_object( dir );
+    free( nameW );
     if (thread->queue_shared_mapping)
     {
         memset( (void *)thread->queue_shared, 0, sizeof(*thread->queue_shared) );
         thread->queue_shared->input_tid = thread->id;
+
+        /* unnamed, the handle is only given to the thread itself */
+        thread->queue_client_mapping = create_client_shared_mapping( NULL, NULL, sizeof(struct queue_client_memory),
+                                                                     NULL, (void **)&thread->queue_client );
+        if (thread->queue_client_mapping) memset( (void *)thread->queue_client, 0, sizeof(*thread->queue_client) );
     }
+    release_object( dir );
 
-    free( nameW );
-    return thread->queue_shared;
+    return thread->queue_client_mapping ? thread->queue_shared : NULL;
 }
 
 
@@ -563,6 +570,8 @@ static void cleanup_thread( struct thread *thread )
     free( thread->desc );
     if (thread->queue_shared_mapping) release_object( thread->queue_shared_mapping );
     thread->queue_shared_mapping = NULL;
+    if (thread->queue_client_mapping) release_object( thread->queue_client_mapping );
+    thread->queue_client_mapping = NULL;
     if (thread->input_shared_mapping) release_object( thread->input_shared_mapping );
     thread->input_shared_mapping = NULL;
     thread->req_data = NULL;
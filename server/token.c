@@ -104,6 +104,17 @@ struct type_descr token_type =
     },
 };
 
+#define ACCESS_CACHE_SIZE 8
+
+/* cached result of an access check against an object security descriptor */
+struct access_cache_entry
+{
+    unsigned int   sd_serial;       /* serial of the checked security descriptor, 0 if unused */
+    unsigned int   desired;         /* desired access */
+    unsigned int   granted;         /* granted access */
+    unsigned int   status;          /* access check status */
+};
+
 struct token
 {
     struct object  obj;             /* object header */
@@ -119,6 +130,9 @@ struct token
     struct acl    *default_dacl;    /* the default DACL to assign to objects created by this user */
     int            impersonation_level; /* impersonation level this token is capable of if non-primary token */
     int            elevation;       /* elevation type */
+    struct luid    access_cache_id; /* modified_id the access cache is valid for */
+    unsigned int   access_cache_next; /* next access cache entry to replace */
+    struct access_cache_entry access_cache[ACCESS_CACHE_SIZE]; /* recent access check results */
 };
 
 struct privilege
@@ -531,6 +545,9 @@ static struct token *create_token( unsigned int primary, unsigned int session_id
         token->default_dacl = NULL;
         token->primary_group = NULL;
         token->elevation = elevation;
+        token->access_cache_id = token->modified_id;
+        token->access_cache_next = 0;
+        memset( token->access_cache, 0, sizeof(token->access_cache) );
 
         /* copy user */
         token->user = memdup( user, sid_len( user ));
@@ -1094,10 +1111,45 @@ unsigned int token_get_session_id( struct token *token )
     return token->session_id;
 }
 
+/* find a cached access check result, flushing the cache if the token has been modified */
+static struct access_cache_entry *find_cached_access( struct token *token, unsigned int sd_serial,
+                                                      unsigned int desired )
+{
+    unsigned int i;
+
+    if (token->access_cache_id.low_part != token->modified_id.low_part ||
+        token->access_cache_id.high_part != token->modified_id.high_part)
+    {
+        memset( token->access_cache, 0, sizeof(token->access_cache) );
+        token->access_cache_id = token->modified_id;
+        return NULL;
+    }
+
+    for (i = 0; i < ACCESS_CACHE_SIZE; i++)
+    {
+        struct access_cache_entry *entry = &token->access_cache[i];
+        if (entry->sd_serial == sd_serial && entry->desired == desired) return entry;
+    }
+    return NULL;
+}
+
+static void cache_access( struct token *token, unsigned int sd_serial, unsigned int desired,
+                          unsigned int granted, unsigned int status )
+{
+    struct access_cache_entry *entry = &token->access_cache[token->access_cache_next];
+
+    token->access_cache_next = (token->access_cache_next + 1) % ACCESS_CACHE_SIZE;
+    entry->sd_serial = sd_serial;
+    entry->desired   = desired;
+    entry->granted   = granted;
+    entry->status    = status;
+}
+
 int check_object_access(struct token *token, struct object *obj, unsigned int *access)
 {
+    struct access_cache_entry *entry;
     generic_map_t mapping;
-    unsigned int status;
+    unsigned int status, desired = *access;
     int res;
 
     if (!token)
@@ -1111,14 +1163,27 @@ int check_object_access(struct token *token, struct object *obj, unsigned int *a
         return TRUE;
     }
 
+    /* the result only depends on the descriptor and the token, which are both unchanged */
+    if (obj->sd_serial && (entry = find_cached_access( token, obj->sd_serial, desired )))
+    {
+        *access = entry->granted;
+        res = entry->status == STATUS_SUCCESS;
+        if (!res) set_error( STATUS_ACCESS_DENIED );
+        return res;
+    }
+
     mapping.read  = obj->ops->map_access( obj, GENERIC_READ );
     mapping.write = obj->ops->map_access( obj, GENERIC_WRITE );
     mapping.exec = obj->ops->map_access( obj, GENERIC_EXECUTE );
 
-    res = token_access_check( token, obj->sd, *access, NULL, NULL,
-                              &mapping, access, &status ) == STATUS_SUCCESS &&
-          status == STATUS_SUCCESS;
+    if (token_access_check( token, obj->sd, desired, NULL, NULL, &mapping, access, &status ) != STATUS_SUCCESS)
+    {
+        set_error( STATUS_ACCESS_DENIED );
+        return FALSE;
+    }
+    if (obj->sd_serial) cache_access( token, obj->sd_serial, desired, *access, status );
 
+    res = status == STATUS_SUCCESS;
     if (!res) set_error( STATUS_ACCESS_DENIED );
     return res;
 }
@@ -1356,6 +1356,25 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_completion_msgs( const char *prefix, data_size_t size )
+{
+    const struct completion_msg *msg;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*msg))
+    {
+        msg = cur_data;
+        dump_uint64( "{ckey=", &msg->ckey );
+        dump_uint64( ",cvalue=", &msg->cvalue );
+        dump_uint64( ",information=", &msg->information );
+        fprintf( stderr, ",status=%08x}", msg->status );
+        size -= sizeof(*msg);
+        remove_data( sizeof(*msg) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 static void dump_varargs_cpu_topology_override( const char *prefix, data_size_t size )
 {
     const struct cpu_topology_override *cpu_topology = cur_data;
@@ -82,6 +82,10 @@ unsigned int hash_strW( const WCHAR *str, data_size_t len, unsigned int hash_siz
     unsigned int i, hash = 0;
 
     for (i = 0; i < len / sizeof(WCHAR); i++) hash = hash * 65599 + to_lower( str[i] );
+    /* mix the bits, names often only differ in their last characters */
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
     return hash % hash_size;
 }
 
@@ -237,6 +237,15 @@ static inline int intersect_rect( rectangle_t *dst, const rectangle_t *src1, con
     return !is_rect_empty( dst );
 }
 
+/* compute the bounding rectangle of two non-empty rectangles */
+static inline void union_rect( rectangle_t *dst, const rectangle_t *src1, const rectangle_t *src2 )
+{
+    dst->left   = min( src1->left, src2->left );
+    dst->top    = min( src1->top, src2->top );
+    dst->right  = max( src1->right, src2->right );
+    dst->bottom = max( src1->bottom, src2->bottom );
+}
+
 /* validate a window handle and return the full handle */
 static inline user_handle_t get_valid_window_handle( user_handle_t win )
 {
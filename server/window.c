@@ -44,6 +44,7 @@ struct property
     unsigned short type;     /* property type (see below) */
     atom_t         atom;     /* property atom */
     lparam_t       data;     /* property data (user-defined storage) */
+    int            next;     /* next property in the same hash bucket */
 };
 
 enum property_type
@@ -53,6 +54,8 @@ enum property_type
     PROP_TYPE_ATOM    /* plain atom */
 };
 
+#define PROP_HASH_MIN_ALLOC 32  /* below this size properties are searched linearly */
+
 
 struct window
 {
@@ -73,6 +76,10 @@ struct window
     rectangle_t      client_rect;     /* client rectangle (relative to parent client area) */
     struct region   *win_region;      /* region for shaped windows (relative to window rect) */
     struct region   *update_region;   /* update region (relative to window rect) */
+    struct region   *vis_cache;       /* last computed visible region */
+    unsigned int     vis_cache_flags; /* DCX flags of the cached visible region */
+    unsigned int     vis_cache_serial; /* layout serial of the cached visible region */
+    struct child_index *child_index;  /* spatial index of the visible children */
     unsigned int     style;           /* window style */
     unsigned int     ex_style;        /* window extended style */
     unsigned int     id;              /* window id */
@@ -80,6 +87,7 @@ struct window
     unsigned int     is_unicode : 1;  /* ANSI or unicode */
     unsigned int     is_linked : 1;   /* is it linked into the parent z-order list? */
     unsigned int     is_layered : 1;  /* has layered info been set? */
+    unsigned int     children_indexed : 1; /* is the children index up to date? */
     unsigned int     color_key;       /* color key for a layered window */
     unsigned int     alpha;           /* alpha value for a layered window */
     unsigned int     layered_flags;   /* flags for a layered window */
@@ -91,6 +99,9 @@ struct window
     unsigned int     paint_flags;     /* various painting flags */
     int              prop_inuse;      /* number of in-use window properties */
     int              prop_alloc;      /* number of allocated window properties */
+    int              prop_free;       /* number of free entries below prop_inuse */
+    int             *prop_hash;       /* property hash buckets, indexed by atom */
+    unsigned int     prop_hash_mask;  /* mask for the hash bucket index */
     struct property *properties;      /* window properties array */
     int              nb_extra_bytes;  /* number of extra bytes */
     char             extra_bytes[1];  /* extra bytes storage */
@@ -107,6 +118,38 @@ struct window
 #define PAINT_DELAYED_ERASE      0x0080  /* still needs erase after WM_ERASEBKGND */
 #define PAINT_PIXEL_FORMAT_CHILD 0x0100  /* at least one child has a custom pixel format */
 
+/* spatial index of the children of a window, used for hit testing */
+struct child_index
+{
+    unsigned int     count;           /* number of indexed children */
+    struct window  **windows;         /* indexed children in z-order */
+    rectangle_t      bounds;          /* union of the children visible rects */
+    unsigned int     cols;            /* number of grid columns */
+    unsigned int     rows;            /* number of grid rows */
+    int              cell_width;      /* width of a grid cell */
+    int              cell_height;     /* height of a grid cell */
+    unsigned int    *cells;           /* offset of each cell in items, plus end offset */
+    unsigned int    *items;           /* indices of the children overlapping each cell, in z-order */
+    unsigned int     large_count;     /* number of children too large for the grid */
+    unsigned int    *large;           /* indices of the children too large for the grid */
+};
+
+#define CHILD_INDEX_MIN_COUNT  32  /* don't bother indexing windows with fewer children */
+#define CHILD_INDEX_MAX_GRID   64  /* maximum number of rows and columns */
+#define CHILD_INDEX_MAX_CELLS  16  /* children covering more cells are checked separately */
+
+/* iterator over the children that may contain a given point, in z-order */
+struct child_iter
+{
+    struct window            *parent;
+    const struct child_index *index;
+    struct list              *entry;
+    const unsigned int       *cell;
+    const unsigned int       *cell_end;
+    const unsigned int       *large;
+    const unsigned int       *large_end;
+};
+
 /* growable array of user handles */
 struct user_handle_array
 {
@@ -117,6 +160,9 @@ struct user_handle_array
 
 static const rectangle_t empty_rect;
 
+/* incremented whenever the position, z-order or visibility of a window changes */
+static unsigned int layout_serial = 1;
+
 /* global window pointers */
 static struct window *shell_window;
 static struct window *shell_listview;
@@ -187,6 +233,13 @@ static unsigned int get_monitor_dpi( struct window *win )
     return win->dpi ? win->dpi : USER_DEFAULT_SCREEN_DPI;
 }
 
+/* invalidate the cached state that depends on the layout of a window */
+static void window_layout_changed( struct window *win )
+{
+    if (!++layout_serial) layout_serial = 1;
+    if (win->parent) win->parent->children_indexed = 0;
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -240,6 +293,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    window_layout_changed( win );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -259,6 +313,7 @@ static int set_parent_window( struct window *win, struct window *parent )
 
     if (parent)
     {
+        window_layout_changed( win );  /* drop it from the index of the previous parent */
         win->parent = parent;
         link_window( win, WINPTR_TOP );
 
@@ -281,6 +336,7 @@ static int set_parent_window( struct window *win, struct window *parent )
         list_remove( &win->entry );  /* unlink it from the previous location */
         list_add_head( &win->parent->unlinked, &win->entry );
         win->is_linked = 0;
+        window_layout_changed( win );
     }
     return 1;
 }
@@ -305,6 +361,50 @@ static int add_handle_to_array( struct user_handle_array *array, user_handle_t h
     return 1;
 }
 
+/* rebuild the property hash table after the properties array has grown */
+static void rebuild_property_hash( struct window *win )
+{
+    unsigned int size = 16;
+    int i, *bucket;
+
+    free( win->prop_hash );
+    win->prop_hash = NULL;
+    if (win->prop_alloc < PROP_HASH_MIN_ALLOC) return;
+
+    while (size < win->prop_alloc) size *= 2;
+    if (!(win->prop_hash = malloc( size * sizeof(*win->prop_hash) ))) return;  /* fall back to linear search */
+    win->prop_hash_mask = size - 1;
+    for (i = 0; i < size; i++) win->prop_hash[i] = -1;
+
+    for (i = 0; i < win->prop_inuse; i++)
+    {
+        if (win->properties[i].type == PROP_TYPE_FREE) continue;
+        bucket = &win->prop_hash[win->properties[i].atom & win->prop_hash_mask];
+        win->properties[i].next = *bucket;
+        *bucket = i;
+    }
+}
+
+/* find the index of a window property, or -1 if not found */
+static int find_property( struct window *win, atom_t atom )
+{
+    int i;
+
+    if (win->prop_hash)
+    {
+        for (i = win->prop_hash[atom & win->prop_hash_mask]; i != -1; i = win->properties[i].next)
+            if (win->properties[i].atom == atom) return i;
+        return -1;
+    }
+
+    for (i = 0; i < win->prop_inuse; i++)
+    {
+        if (win->properties[i].type == PROP_TYPE_FREE) continue;
+        if (win->properties[i].atom == atom) return i;
+    }
+    return -1;
+}
+
 /* set a window property */
 static void set_property( struct window *win, atom_t atom, lparam_t data, enum property_type type )
 {
@@ -312,24 +412,22 @@ static void set_property( struct window *win, atom_t atom, lparam_t data, enum p
     struct property *new_props;
 
     /* check if it exists already */
-    for (i = 0; i < win->prop_inuse; i++)
+    if ((i = find_property( win, atom )) != -1)
     {
-        if (win->properties[i].type == PROP_TYPE_FREE)
-        {
-            free = i;
-            continue;
-        }
-        if (win->properties[i].atom == atom)
-        {
-            win->properties[i].type = type;
-            win->properties[i].data = data;
-            return;
-        }
+        win->properties[i].type = type;
+        win->properties[i].data = data;
+        return;
     }
 
     /* need to add an entry */
     if (!grab_global_atom( NULL, atom )) return;
-    if (free == -1)
+    if (win->prop_free)
+    {
+        /* reuse the last free entry */
+        for (free = win->prop_inuse - 1; win->properties[free].type != PROP_TYPE_FREE; free--) ;
+        win->prop_free--;
+    }
+    else
     {
         /* no free entry */
         if (win->prop_inuse >= win->prop_alloc)
@@ -344,28 +442,37 @@ static void set_property( struct window *win, atom_t atom, lparam_t data, enum p
             }
             win->prop_alloc += 16;
             win->properties = new_props;
+            rebuild_property_hash( win );
         }
         free = win->prop_inuse++;
     }
     win->properties[free].atom = atom;
     win->properties[free].type = type;
     win->properties[free].data = data;
+    if (win->prop_hash)
+    {
+        int *bucket = &win->prop_hash[atom & win->prop_hash_mask];
+        win->properties[free].next = *bucket;
+        *bucket = free;
+    }
 }
 
 /* remove a window property */
 static lparam_t remove_property( struct window *win, atom_t atom )
 {
-    int i;
+    int i, *ptr;
 
-    for (i = 0; i < win->prop_inuse; i++)
+    if ((i = find_property( win, atom )) != -1)
     {
-        if (win->properties[i].type == PROP_TYPE_FREE) continue;
-        if (win->properties[i].atom == atom)
+        if (win->prop_hash)
         {
-            release_global_atom( NULL, atom );
-            win->properties[i].type = PROP_TYPE_FREE;
-            return win->properties[i].data;
+            for (ptr = &win->prop_hash[atom & win->prop_hash_mask]; *ptr != i; ptr = &win->properties[*ptr].next) ;
+            *ptr = win->properties[i].next;
         }
+        release_global_atom( NULL, atom );
+        win->properties[i].type = PROP_TYPE_FREE;
+        win->prop_free++;
+        return win->properties[i].data;
     }
     /* FIXME: last error? */
     return 0;
@@ -376,11 +483,7 @@ static lparam_t get_property( struct window *win, atom_t atom )
 {
     int i;
 
-    for (i = 0; i < win->prop_inuse; i++)
-    {
-        if (win->properties[i].type == PROP_TYPE_FREE) continue;
-        if (win->properties[i].atom == atom) return win->properties[i].data;
-    }
+    if ((i = find_property( win, atom )) != -1) return win->properties[i].data;
     /* FIXME: last error? */
     return 0;
 }
@@ -396,6 +499,7 @@ static inline void destroy_properties( struct window *win )
         if (win->properties[i].type == PROP_TYPE_FREE) continue;
         release_global_atom( NULL, win->properties[i].atom );
     }
+    free( win->prop_hash );
     free( win->properties );
 }
 
@@ -495,6 +599,10 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->last_active    = win->handle;
     win->win_region     = NULL;
     win->update_region  = NULL;
+    win->vis_cache      = NULL;
+    win->vis_cache_flags = 0;
+    win->vis_cache_serial = 0;
+    win->child_index    = NULL;
     win->style          = 0;
     win->ex_style       = 0;
     win->id             = 0;
@@ -502,6 +610,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->is_unicode     = 1;
     win->is_linked      = 0;
     win->is_layered     = 0;
+    win->children_indexed = 0;
     win->dpi_awareness  = DPI_AWARENESS_PER_MONITOR_AWARE;
     win->dpi            = 0;
     win->user_data      = 0;
@@ -510,6 +619,9 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->paint_flags    = 0;
     win->prop_inuse     = 0;
     win->prop_alloc     = 0;
+    win->prop_free      = 0;
+    win->prop_hash      = NULL;
+    win->prop_hash_mask = 0;
     win->properties     = NULL;
     win->nb_extra_bytes = extra_bytes;
     win->window_rect = win->visible_rect = win->surface_rect = win->client_rect = empty_rect;
@@ -727,6 +839,155 @@ static int is_point_in_window( struct window *win, int *x, int *y, unsigned int
     return 1;
 }
 
+/* free the spatial index of the children of a window */
+static void free_child_index( struct child_index *index )
+{
+    if (!index) return;
+    free( index->windows );
+    free( index->cells );
+    free( index->items );
+    free( index->large );
+    free( index );
+}
+
+/* build a spatial index of the children of a window */
+/* returns NULL if the children should simply be walked in z-order */
+static struct child_index *build_child_index( struct window *parent )
+{
+    struct child_index *index;
+    struct window *ptr;
+    unsigned int i, count = 0, items = 0;
+    rectangle_t bounds = empty_rect;
+
+    LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
+    {
+        if (!(ptr->style & WS_VISIBLE) || is_rect_empty( &ptr->visible_rect )) continue;
+        if (ptr->dpi != parent->dpi) return NULL;  /* the point needs to be mapped */
+        if (!count++) bounds = ptr->visible_rect;
+        else union_rect( &bounds, &bounds, &ptr->visible_rect );
+    }
+    if (count < CHILD_INDEX_MIN_COUNT) return NULL;
+
+    if (!(index = mem_alloc( sizeof(*index) ))) return NULL;
+    memset( index, 0, sizeof(*index) );
+    index->bounds = bounds;
+    for (index->cols = 1; index->cols < CHILD_INDEX_MAX_GRID && index->cols * index->cols < count; index->cols++)
+        ;
+    index->rows = index->cols;
+    index->cell_width = (bounds.right - bounds.left + index->cols - 1) / index->cols;
+    index->cell_height = (bounds.bottom - bounds.top + index->rows - 1) / index->rows;
+
+    if (!(index->windows = mem_alloc( count * sizeof(*index->windows) ))) goto failed;
+    if (!(index->cells = mem_alloc( (index->cols * index->rows + 1) * sizeof(*index->cells) ))) goto failed;
+    if (!(index->large = mem_alloc( count * sizeof(*index->large) ))) goto failed;
+    memset( index->cells, 0, (index->cols * index->rows + 1) * sizeof(*index->cells) );
+
+    /* count the children in each cell, cells[i + 1] temporarily holds the count for cell i */
+
+    LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
+    {
+        unsigned int left, top, right, bottom, x, y;
+
+        if (!(ptr->style & WS_VISIBLE) || is_rect_empty( &ptr->visible_rect )) continue;
+        i = index->count++;
+        index->windows[i] = ptr;
+        left   = (ptr->visible_rect.left - bounds.left) / index->cell_width;
+        top    = (ptr->visible_rect.top - bounds.top) / index->cell_height;
+        right  = (ptr->visible_rect.right - 1 - bounds.left) / index->cell_width;
+        bottom = (ptr->visible_rect.bottom - 1 - bounds.top) / index->cell_height;
+        if ((right - left + 1) * (bottom - top + 1) > CHILD_INDEX_MAX_CELLS)
+        {
+            index->large[index->large_count++] = i;
+            continue;
+        }
+        for (y = top; y <= bottom; y++)
+            for (x = left; x <= right; x++) index->cells[y * index->cols + x + 1]++;
+        items += (right - left + 1) * (bottom - top + 1);
+    }
+
+    /* convert the counts to the offset of the first item of each cell */
+
+    for (i = 1; i <= index->cols * index->rows; i++) index->cells[i] += index->cells[i - 1];
+    if (!(index->items = mem_alloc( max( items, 1 ) * sizeof(*index->items) ))) goto failed;
+
+    for (i = 0; i < index->count; i++)
+    {
+        unsigned int left, top, right, bottom, x, y;
+
+        ptr = index->windows[i];
+        left   = (ptr->visible_rect.left - bounds.left) / index->cell_width;
+        top    = (ptr->visible_rect.top - bounds.top) / index->cell_height;
+        right  = (ptr->visible_rect.right - 1 - bounds.left) / index->cell_width;
+        bottom = (ptr->visible_rect.bottom - 1 - bounds.top) / index->cell_height;
+        if ((right - left + 1) * (bottom - top + 1) > CHILD_INDEX_MAX_CELLS) continue;
+        for (y = top; y <= bottom; y++)
+            for (x = left; x <= right; x++)
+            {
+                unsigned int *pos = &index->cells[y * index->cols + x];
+                index->items[(*pos)++] = i;
+            }
+    }
+
+    /* filling moved each offset to the start of the next cell, shift them back */
+
+    memmove( index->cells + 1, index->cells, index->cols * index->rows * sizeof(*index->cells) );
+    index->cells[0] = 0;
+    return index;
+
+failed:
+    free_child_index( index );
+    return NULL;
+}
+
+/* get the spatial index of the children of a window, rebuilding it if needed */
+static const struct child_index *get_child_index( struct window *parent )
+{
+    if (!parent->children_indexed)
+    {
+        free_child_index( parent->child_index );
+        parent->child_index = build_child_index( parent );
+        parent->children_indexed = 1;
+    }
+    return parent->child_index;
+}
+
+/* start iterating over the children that may contain a point (in parent-relative coords) */
+static void init_child_iter( struct child_iter *iter, struct window *parent, int x, int y )
+{
+    const struct child_index *index = get_child_index( parent );
+
+    iter->parent = parent;
+    iter->index  = index;
+    iter->entry  = &parent->children;
+    iter->cell = iter->cell_end = iter->large = iter->large_end = NULL;
+
+    if (!index || !point_in_rect( &index->bounds, x, y )) return;
+    x = (x - index->bounds.left) / index->cell_width;
+    y = (y - index->bounds.top) / index->cell_height;
+    iter->cell      = index->items + index->cells[y * index->cols + x];
+    iter->cell_end  = index->items + index->cells[y * index->cols + x + 1];
+    iter->large     = index->large;
+    iter->large_end = index->large + index->large_count;
+}
+
+/* get the next child that may contain the point, merging the cell and large windows in z-order */
+static struct window *next_child_iter( struct child_iter *iter )
+{
+    struct list *entry;
+
+    if (!iter->index)
+    {
+        if (!(entry = list_next( &iter->parent->children, iter->entry ))) return NULL;
+        iter->entry = entry;
+        return LIST_ENTRY( entry, struct window, entry );
+    }
+    if (iter->cell < iter->cell_end && (iter->large == iter->large_end || *iter->cell < *iter->large))
+        return iter->index->windows[*iter->cell++];
+    if (iter->large < iter->large_end)
+        return iter->index->windows[*iter->large++];
+    return NULL;
+}
+
 /* fill an array with the handles of the children of a specified window */
 static unsigned int get_children_windows( struct window *parent, atom_t atom, thread_id_t tid,
                                           user_handle_t *handles, unsigned int max_count )
@@ -753,9 +1014,11 @@ static unsigned int get_children_windows( struct window *parent, atom_t atom, th
 /* find child of 'parent' that contains the given point (in parent-relative coords) */
 static struct window *child_window_from_point( struct window *parent, int x, int y )
 {
+    struct child_iter iter;
     struct window *ptr;
 
-    LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
+    init_child_iter( &iter, parent, x, y );
+    while ((ptr = next_child_iter( &iter )))
     {
         int x_child = x, y_child = y;
 
@@ -777,9 +1040,11 @@ static struct window *child_window_from_point( struct window *parent, int x, int
 static int get_window_children_from_point( struct window *parent, int x, int y,
                                            struct user_handle_array *array )
 {
+    struct child_iter iter;
     struct window *ptr;
 
-    LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
+    init_child_iter( &iter, parent, x, y );
+    while ((ptr = next_child_iter( &iter )))
     {
         int x_child = x, y_child = y;
 
@@ -964,13 +1229,17 @@ static struct region *clip_children( struct window *parent, struct window *last,
 {
     struct window *ptr;
     struct region *tmp = create_empty_region();
+    rectangle_t extents, rect;
 
     if (!tmp) return NULL;
+    get_region_extents( region, &extents );
+    offset_rect( &extents, -offset_x, -offset_y );
     LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
     {
         if (ptr == last) break;
         if (!(ptr->style & WS_VISIBLE)) continue;
         if (ptr->ex_style & WS_EX_TRANSPARENT) continue;
+        if (!intersect_rect( &rect, &ptr->visible_rect, &extents )) continue;
         set_region_rect( tmp, &ptr->visible_rect );
         if (ptr->win_region && !intersect_window_region( tmp, ptr ))
         {
@@ -980,6 +1249,8 @@ static struct region *clip_children( struct window *parent, struct window *last,
         offset_region( tmp, offset_x, offset_y );
         if (!(region = subtract_region( region, region, tmp ))) break;
         if (is_region_empty( region )) break;
+        get_region_extents( region, &extents );
+        offset_rect( &extents, -offset_x, -offset_y );
     }
     free_region( tmp );
     return region;
@@ -1017,7 +1288,7 @@ static inline struct window *get_top_clipping_window( struct window *win )
 
 
 /* compute the visible region of a window, in window coordinates */
-static struct region *get_visible_region( struct window *win, unsigned int flags )
+static struct region *compute_visible_region( struct window *win, unsigned int flags )
 {
     struct region *tmp = NULL, *region;
     int offset_x, offset_y;
@@ -1096,6 +1367,32 @@ error:
 }
 
 
+/* get the visible region of a window, in window coordinates */
+static struct region *get_visible_region( struct window *win, unsigned int flags )
+{
+    struct region *region;
+
+    if (win->vis_cache && win->vis_cache_serial == layout_serial && win->vis_cache_flags == flags)
+    {
+        if (!(region = create_empty_region())) return NULL;
+        if (copy_region( region, win->vis_cache )) return region;
+        free_region( region );
+        return NULL;
+    }
+
+    if (!(region = compute_visible_region( win, flags ))) return NULL;
+
+    if (!win->vis_cache) win->vis_cache = create_empty_region();
+    if (win->vis_cache && copy_region( win->vis_cache, region ))
+    {
+        win->vis_cache_flags = flags;
+        win->vis_cache_serial = layout_serial;
+    }
+    else win->vis_cache_serial = 0;
+    return region;
+}
+
+
 /* clip all children with a custom pixel format out of the visible region */
 static struct region *clip_pixel_format_children( struct window *parent, struct region *parent_clip,
                                                   struct region *region, int offset_x, int offset_y )
@@ -1702,6 +1999,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    window_layout_changed( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1717,6 +2015,7 @@ static void set_window_pos( struct window *win, struct window *previous,
             offset_rect( &child->surface_rect, new_size - old_size, 0 );
             offset_rect( &child->client_rect, new_size - old_size, 0 );
         }
+        win->children_indexed = 0;
     }
 
     /* reset cursor clip rectangle when the desktop changes size */
@@ -1857,6 +2156,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    window_layout_changed( win );
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1878,6 +2178,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        window_layout_changed( win );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1905,6 +2206,7 @@ void destroy_window( struct window *win )
     free_user_handle( win->handle );
     destroy_properties( win );
     list_remove( &win->entry );
+    window_layout_changed( win );
     if (is_desktop_window(win))
     {
         struct desktop *desktop = win->desktop;
@@ -1920,6 +2222,8 @@ void destroy_window( struct window *win )
     detach_window_thread( win );
     if (win->win_region) free_region( win->win_region );
     if (win->update_region) free_region( win->update_region );
+    if (win->vis_cache) free_region( win->vis_cache );
+    free_child_index( win->child_index );
     if (win->class) release_class( win->class );
     free( win->text );
     memset( win, 0x55, sizeof(*win) + win->nb_extra_bytes - 1 );
@@ -2142,6 +2446,7 @@ DECL_HANDLER(set_window_info)
         else win->ex_style = (req->ex_style & ~WS_EX_TOPMOST) | (win->ex_style & WS_EX_TOPMOST);
         if (!(win->ex_style & WS_EX_LAYERED)) win->is_layered = 0;
     }
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) window_layout_changed( win );
     if (req->flags & SET_WIN_ID) win->id = req->id;
     if (req->flags & SET_WIN_INSTANCE) win->instance = req->instance;
     if (req->flags & SET_WIN_UNICODE) win->is_unicode = req->is_unicode;
@@ -2673,6 +2978,7 @@ DECL_HANDLER(update_window_zorder)
         {
             list_remove( &win->entry );
             list_add_before( &ptr->entry, &win->entry );
+            window_layout_changed( win );
         }
         break;
     }
@@ -2772,9 +3078,7 @@ DECL_HANDLER(get_window_properties)
     reply->total = 0;
     if (!win) return;
 
-    for (i = count = 0; i < win->prop_inuse; i++)
-        if (win->properties[i].type != PROP_TYPE_FREE) count++;
-    reply->total = count;
+    reply->total = count = win->prop_inuse - win->prop_free;
 
     if (count > max) count = max;
     if (!count || !(data = set_reply_data_size( count * sizeof(*data) ))) return;